@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef ATOMIC_SNAPSHOT_H
+#define ATOMIC_SNAPSHOT_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+// Immutable values published by a single thread and read from any. Reading is one
+// acquire load, without the reference counting and the lock std::atomic_load() of
+// a shared_ptr takes.
+//
+// A replaced value is retired and only freed once the generation after it is
+// replaced too. Settings change when the user changes them, far apart, so readers
+// on other threads are long done with it by then. Readers keep the pointer for the
+// lookup at hand only, what outlives it is copied.
+template <typename T>
+class AtomicSnapshot
+{
+public:
+    AtomicSnapshot()
+        : m_current(new T)
+    {
+    }
+
+    ~AtomicSnapshot()
+    {
+        delete m_current.load(std::memory_order_relaxed);
+        delete m_retired;
+    }
+
+    inline const T *load() const
+    {
+        return m_current.load(std::memory_order_acquire);
+    }
+
+    // Takes ownership, only to be called by the publishing thread
+    void publish(const T *value)
+    {
+        delete m_retired;
+        m_retired = m_current.exchange(value, std::memory_order_acq_rel);
+    }
+
+private:
+    Q_DISABLE_COPY(AtomicSnapshot)
+
+    std::atomic<const T *> m_current;
+    const T *m_retired = nullptr;
+};
+
+#endif // ATOMIC_SNAPSHOT_H
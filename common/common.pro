@@ -14,8 +14,36 @@ QT += core \
 PKGCONFIG += gtk+-3.0 \
              gtk+-x11-3.0
 
-SOURCES += gnomehintssettings.cpp \
-           qgtk3dialoghelpers.cpp
+SOURCES += cursorblinktracker.cpp \
+           dconfreader.cpp \
+           gnomehintssettings.cpp \
+           gsettingsbackend.cpp \
+           gsettingsworker.cpp \
+           gtkpalette.cpp \
+           kvantumconfigwriter.cpp \
+           phasetrace.cpp \
+           portalsettingsbackend.cpp \
+           powerprofilemonitor.cpp \
+           qgtk3dialoghelpers.cpp \
+           runtimestats.cpp \
+           settingsbackend.cpp \
+           xdgdataindex.cpp \
+           xfconfsettingsbackend.cpp
 
-HEADERS += gnomehintssettings.h \
-           qgtk3dialoghelpers.h
+HEADERS += atomicsnapshot.h \
+           cursorblinktracker.h \
+           dconfreader.h \
+           gnomehintssettings.h \
+           gsettingsbackend.h \
+           gsettingsworker.h \
+           gtkpalette.h \
+           kvantumconfigwriter.h \
+           phasetrace.h \
+           portalsettingsbackend.h \
+           powerprofilemonitor.h \
+           qgtk3dialoghelpers.h \
+           runtimestats.h \
+           settingsbackend.h \
+           themehinttable.h \
+           xdgdataindex.h \
+           xfconfsettingsbackend.h
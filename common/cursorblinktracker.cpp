@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "cursorblinktracker.h"
+
+#include <QEvent>
+#include <QGuiApplication>
+#include <QStyleHints>
+
+CursorBlinkTracker::CursorBlinkTracker(QObject *parent)
+    : QObject(parent)
+{
+    m_idleTimer.setSingleShot(true);
+    connect(&m_idleTimer, &QTimer::timeout, this, &CursorBlinkTracker::checkIdle);
+}
+
+void CursorBlinkTracker::setBlinking(int flashTime, int timeout)
+{
+    m_flashTime = flashTime;
+    m_timeout = timeout;
+    m_idle = false;
+
+    const bool track = flashTime > 0 && timeout > 0 && qobject_cast<QGuiApplication *>(QCoreApplication::instance());
+    if (track != m_filtering) {
+        if (track) {
+            QCoreApplication::instance()->installEventFilter(this);
+        } else {
+            QCoreApplication::instance()->removeEventFilter(this);
+        }
+        m_filtering = track;
+    }
+
+    if (track) {
+        m_lastInput.start();
+        m_idleTimer.start(timeout);
+    } else {
+        m_idleTimer.stop();
+    }
+}
+
+bool CursorBlinkTracker::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::KeyPress:
+    case QEvent::MouseButtonPress:
+    case QEvent::Wheel:
+    case QEvent::InputMethod:
+    case QEvent::TouchBegin:
+    case QEvent::FocusIn:
+    case QEvent::WindowActivate:
+        // Only a clock read on every input, the timer is rescheduled once it expires
+        m_lastInput.restart();
+        if (m_idle) {
+            m_idle = false;
+            setFlashTime(m_flashTime);
+            m_idleTimer.start(m_timeout);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return QObject::eventFilter(watched, event);
+}
+
+void CursorBlinkTracker::checkIdle()
+{
+    const qint64 remaining = m_timeout - m_lastInput.elapsed();
+    if (remaining > 0) {
+        m_idleTimer.start(int(remaining));
+        return;
+    }
+
+    m_idle = true;
+    setFlashTime(0);
+}
+
+void CursorBlinkTracker::setFlashTime(int flashTime)
+{
+    // Text widgets follow the style hints, a flash time of 0 shows the cursor steadily
+    QGuiApplication::styleHints()->setCursorFlashTime(flashTime);
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef CURSOR_BLINK_TRACKER_H
+#define CURSOR_BLINK_TRACKER_H
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+// Stops the text cursor from blinking after a while without user input, like GTK
+// does with cursor-blink-timeout, and lets it blink again on the next input. An
+// idle application then has no caret timer waking it up.
+class CursorBlinkTracker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CursorBlinkTracker(QObject *parent = nullptr);
+
+    // Blink with the given period, stopping after timeout milliseconds without
+    // input. A timeout of 0 keeps blinking forever.
+    void setBlinking(int flashTime, int timeout);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private Q_SLOTS:
+    void checkIdle();
+
+private:
+    void setFlashTime(int flashTime);
+
+    int m_flashTime = 0;
+    int m_timeout = 0;
+    bool m_idle = false;
+    bool m_filtering = false;
+    QElapsedTimer m_lastInput;
+    QTimer m_idleTimer;
+};
+
+#endif // CURSOR_BLINK_TRACKER_H
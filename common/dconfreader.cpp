@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "dconfreader.h"
+
+#include <QDir>
+#include <QFile>
+#include <QStandardPaths>
+#include <QtEndian>
+
+#include <cstring>
+
+// GVDB file layout, see gvdb-format.h in GLib
+static const quint32 gvdbSignature0 = 0x72615647; // "GVar"
+static const quint32 gvdbSignature1 = 0x746e6169; // "iant"
+static const quint32 gvdbHeaderSize = 24;
+static const quint32 gvdbHashHeaderSize = 8;
+static const quint32 gvdbHashItemSize = 24;
+static const quint32 gvdbNoParent = 0xffffffffu;
+
+static inline quint32 readUInt32(const QByteArray &data, quint32 offset)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(data.constData()) + offset);
+}
+
+static inline quint16 readUInt16(const QByteArray &data, quint32 offset)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar *>(data.constData()) + offset);
+}
+
+static quint32 gvdbHash(const QByteArray &key)
+{
+    quint32 hash = 5381;
+    for (const char c : key) {
+        hash = hash * 33 + static_cast<signed char>(c);
+    }
+    return hash;
+}
+
+DConfReader::DConfReader(const QStringList &databases)
+{
+    for (const QString &database : databases) {
+        Table table;
+        Table locks;
+        if (openTable(database, &table, &locks)) {
+            m_tables << table;
+            m_locks << locks;
+        }
+    }
+}
+
+QStringList DConfReader::profileDatabases()
+{
+    const QString configHome = QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation);
+
+    QString profile = QFile::decodeName(qgetenv("DCONF_PROFILE"));
+    if (profile.isEmpty()) {
+        profile = QStringLiteral("user");
+    }
+
+    QString profilePath = profile;
+    if (!QDir::isAbsolutePath(profilePath)) {
+        profilePath = QStringLiteral("/etc/dconf/profile/") + profile;
+        if (!QFile::exists(profilePath)) {
+            profilePath = QStandardPaths::locate(QStandardPaths::GenericDataLocation, QStringLiteral("dconf/profile/") + profile);
+        }
+    }
+
+    QFile profileFile(profilePath);
+    if (profilePath.isEmpty() || !profileFile.open(QIODevice::ReadOnly)) {
+        // Without a profile dconf only uses the user database
+        return { configHome + QStringLiteral("/dconf/user") };
+    }
+
+    QStringList databases;
+    while (!profileFile.atEnd()) {
+        const QString line = QString::fromUtf8(profileFile.readLine()).section(QLatin1Char('#'), 0, 0).trimmed();
+        const QString name = line.section(QLatin1Char(':'), 1);
+
+        if (line.startsWith(QLatin1String("user-db:"))) {
+            databases << configHome + QStringLiteral("/dconf/") + name;
+        } else if (line.startsWith(QLatin1String("system-db:"))) {
+            databases << QStringLiteral("/etc/dconf/db/") + name;
+        } else if (line.startsWith(QLatin1String("file-db:"))) {
+            databases << name;
+        }
+    }
+
+    return databases;
+}
+
+bool DConfReader::isEmpty() const
+{
+    return m_tables.isEmpty();
+}
+
+QVariant DConfReader::value(const QByteArray &key) const
+{
+    // Locks of the first database, the user one, don't count. Like in the dconf
+    // engine the lowest priority database locking the key hides every one before it.
+    int first = 0;
+    for (int i = m_locks.size() - 1; i > 0; --i) {
+        if (findItem(m_locks.at(i), key, 'v') >= 0) {
+            first = i;
+            break;
+        }
+    }
+
+    for (int i = first; i < m_tables.size(); ++i) {
+        const QVariant value = lookup(m_tables.at(i), key);
+        if (value.isValid()) {
+            return value;
+        }
+    }
+
+    return QVariant();
+}
+
+QVariant DConfReader::toVariant(GVariant *value)
+{
+    if (!value) {
+        return QVariant();
+    }
+
+    if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)) {
+        return QString::fromUtf8(g_variant_get_string(value, nullptr));
+    } else if (g_variant_is_of_type(value, G_VARIANT_TYPE_INT32)) {
+        return static_cast<int>(g_variant_get_int32(value));
+    } else if (g_variant_is_of_type(value, G_VARIANT_TYPE_UINT32)) {
+        return static_cast<uint>(g_variant_get_uint32(value));
+    } else if (g_variant_is_of_type(value, G_VARIANT_TYPE_DOUBLE)) {
+        return static_cast<qreal>(g_variant_get_double(value));
+    } else if (g_variant_is_of_type(value, G_VARIANT_TYPE_BOOLEAN)) {
+        return static_cast<bool>(g_variant_get_boolean(value));
+    } else if (g_variant_is_of_type(value, G_VARIANT_TYPE_STRING_ARRAY)) {
+        QStringList list;
+        gsize length = 0;
+        const gchar **strings = g_variant_get_strv(value, &length);
+        for (gsize i = 0; i < length; ++i) {
+            list << QString::fromUtf8(strings[i]);
+        }
+        g_free(strings);
+        return list;
+    }
+
+    return QVariant();
+}
+
+bool DConfReader::openTable(const QString &path, Table *table, Table *locks)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QByteArray data = file.readAll();
+    const quint32 size = data.size();
+    if (size < gvdbHeaderSize) {
+        return false;
+    }
+
+    // Byteswapped databases are written by other architectures only, don't bother
+    if (readUInt32(data, 0) != gvdbSignature0 || readUInt32(data, 4) != gvdbSignature1 || readUInt32(data, 8) != 0) {
+        return false;
+    }
+
+    if (!readHashTable(data, readUInt32(data, 16), readUInt32(data, 20), table)) {
+        return false;
+    }
+
+    // Locks are keys of a nested table, written by "dconf update" from the locks
+    // directory of system databases
+    const qint64 locksItem = findItem(*table, QByteArrayLiteral(".locks"), 'H');
+    if (locksItem >= 0) {
+        const quint32 locksOffset = table->itemsOffset + quint32(locksItem) * gvdbHashItemSize;
+        readHashTable(data, readUInt32(data, locksOffset + 16), readUInt32(data, locksOffset + 20), locks);
+    }
+
+    return true;
+}
+
+bool DConfReader::readHashTable(const QByteArray &data, quint32 rootStart, quint32 rootEnd, Table *table)
+{
+    const quint32 size = data.size();
+    if (rootStart > rootEnd || rootEnd > size || rootStart % 4 || rootEnd - rootStart < gvdbHashHeaderSize) {
+        return false;
+    }
+
+    // The top five bits of the bloom filter size are its shift, we don't use the filter
+    const quint32 bloomWords = readUInt32(data, rootStart) & ((1u << 27) - 1);
+    const quint32 bucketCount = readUInt32(data, rootStart + 4);
+
+    quint64 offset = quint64(rootStart) + gvdbHashHeaderSize + quint64(bloomWords) * 4;
+    if (offset + quint64(bucketCount) * 4 > rootEnd) {
+        return false;
+    }
+
+    table->data = data;
+    table->bucketsOffset = offset;
+    table->bucketCount = bucketCount;
+    offset += quint64(bucketCount) * 4;
+    table->itemsOffset = offset;
+    table->itemCount = (rootEnd - offset) / gvdbHashItemSize;
+
+    return true;
+}
+
+bool DConfReader::checkItemName(const Table &table, quint32 item, const QByteArray &key)
+{
+    quint32 keyLength = key.size();
+
+    // Keys are stored as a chain of fragments, each item holding its part and a
+    // reference to the item with the preceding part
+    for (quint32 depth = 0; depth < table.itemCount; ++depth) {
+        const quint32 itemOffset = table.itemsOffset + item * gvdbHashItemSize;
+        const quint32 parent = readUInt32(table.data, itemOffset + 4);
+        const quint32 fragmentStart = readUInt32(table.data, itemOffset + 8);
+        const quint16 fragmentSize = readUInt16(table.data, itemOffset + 12);
+
+        if (quint64(fragmentStart) + fragmentSize > quint64(table.data.size()) || fragmentSize > keyLength) {
+            return false;
+        }
+
+        keyLength -= fragmentSize;
+        if (std::memcmp(table.data.constData() + fragmentStart, key.constData() + keyLength, fragmentSize) != 0) {
+            return false;
+        }
+
+        if (keyLength == 0 && parent == gvdbNoParent) {
+            return true;
+        }
+
+        if (parent >= table.itemCount || fragmentSize == 0) {
+            return false;
+        }
+
+        item = parent;
+    }
+
+    return false;
+}
+
+qint64 DConfReader::findItem(const Table &table, const QByteArray &key, char type)
+{
+    if (!table.bucketCount || !table.itemCount) {
+        return -1;
+    }
+
+    const quint32 hash = gvdbHash(key);
+    const quint32 bucket = hash % table.bucketCount;
+
+    quint32 item = readUInt32(table.data, table.bucketsOffset + bucket * 4);
+    quint32 lastItem = table.itemCount;
+    if (bucket != table.bucketCount - 1) {
+        lastItem = qMin(readUInt32(table.data, table.bucketsOffset + (bucket + 1) * 4), table.itemCount);
+    }
+
+    for (; item < lastItem; ++item) {
+        const quint32 itemOffset = table.itemsOffset + item * gvdbHashItemSize;
+        if (readUInt32(table.data, itemOffset) != hash || table.data.at(itemOffset + 14) != type) {
+            continue;
+        }
+
+        if (checkItemName(table, item, key)) {
+            return item;
+        }
+    }
+
+    return -1;
+}
+
+QVariant DConfReader::lookup(const Table &table, const QByteArray &key)
+{
+    const qint64 item = findItem(table, key, 'v');
+    if (item < 0) {
+        return QVariant();
+    }
+
+    const quint32 itemOffset = table.itemsOffset + quint32(item) * gvdbHashItemSize;
+    const quint32 valueStart = readUInt32(table.data, itemOffset + 16);
+    const quint32 valueEnd = readUInt32(table.data, itemOffset + 20);
+    if (valueStart > valueEnd || valueEnd > quint32(table.data.size())) {
+        return QVariant();
+    }
+
+    GVariant *variant = g_variant_new_from_data(G_VARIANT_TYPE_VARIANT, table.data.constData() + valueStart,
+                                                valueEnd - valueStart, FALSE, nullptr, nullptr);
+    g_variant_ref_sink(variant);
+    GVariant *value = g_variant_get_variant(variant);
+    const QVariant result = toVariant(value);
+    g_variant_unref(value);
+    g_variant_unref(variant);
+    return result;
+}
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef DCONF_READER_H
+#define DCONF_READER_H
+
+#include <QByteArray>
+#include <QStringList>
+#include <QVariant>
+#include <QVector>
+
+#undef signals
+#include <glib.h>
+#define signals Q_SIGNALS
+
+// Read-only access to dconf databases (GVDB files), without going through GSettings
+// and the dconf engine. Databases are searched in the given order, the first one
+// having the key wins, like the user database overrides the system ones. A key
+// locked by system databases is only looked up from the last one locking it on,
+// as the dconf engine does.
+class DConfReader
+{
+public:
+    explicit DConfReader(const QStringList &databases);
+
+    // Databases of the current dconf profile, see dconf(7)
+    static QStringList profileDatabases();
+
+    bool isEmpty() const;
+
+    // Key is the full dconf path, e.g. /org/gnome/desktop/interface/gtk-theme
+    QVariant value(const QByteArray &key) const;
+
+    static QVariant toVariant(GVariant *value);
+
+private:
+    struct Table {
+        QByteArray data;
+        quint32 bucketsOffset = 0;
+        quint32 bucketCount = 0;
+        quint32 itemsOffset = 0;
+        quint32 itemCount = 0;
+    };
+
+    static bool openTable(const QString &path, Table *table, Table *locks);
+    static bool readHashTable(const QByteArray &data, quint32 rootStart, quint32 rootEnd, Table *table);
+    static bool checkItemName(const Table &table, quint32 item, const QByteArray &key);
+    static qint64 findItem(const Table &table, const QByteArray &key, char type);
+    static QVariant lookup(const Table &table, const QByteArray &key);
+
+    QVector<Table> m_tables;
+    // The .locks table of each database, empty when it has none
+    QVector<Table> m_locks;
+};
+
+#endif // DCONF_READER_H
@@ -18,7 +18,16 @@
  */
 
 #include "gnomehintssettings.h"
-
+#include "cursorblinktracker.h"
+#include "kvantumconfigwriter.h"
+#include "phasetrace.h"
+#include "powerprofilemonitor.h"
+#include "runtimestats.h"
+#include "settingsbackend.h"
+#include "xdgdataindex.h"
+
+#include <QDataStream>
+#include <QDateTime>
 #include <QDir>
 #include <QString>
 #include <QPalette>
@@ -29,252 +38,811 @@
 #include <QToolBar>
 #include <QLoggingCategory>
 #include <QStyleFactory>
+#include <QSaveFile>
 #include <QSettings>
 #include <QStandardPaths>
-
-#include <QDBusArgument>
-#include <QDBusConnection>
-#include <QDBusMessage>
+#include <QStyleHints>
 
 #include <QX11Info>
 
+#include <qpa/qplatformfontdatabase.h>
+#include <qpa/qwindowsysteminterface.h>
+
+#undef signals
+#include <pango/pango.h>
+#define signals Q_SIGNALS
+
 Q_LOGGING_CATEGORY(QGnomePlatform, "qt.qpa.qgnomeplatform")
 
-const QDBusArgument &operator>>(const QDBusArgument &argument, QMap<QString, QVariantMap> &map)
-{
-    argument.beginMap();
-    map.clear();
+// The theme and the decoration plugins link their own copy of this library, so a
+// plain static would give each plugin its own instance. Keep the shared instance
+// on the application object instead, which both plugins can see.
+static const char *sharedInstanceProperty = "_q_qgnomeplatform_hintssettings";
+static GnomeHintsSettings *s_sharedInstance = nullptr;
 
-    while (!argument.atEnd()) {
-        QString key;
-        QVariantMap value;
-        argument.beginMapEntry();
-        argument >> key >> value;
-        argument.endMapEntry();
-        map.insert(key, value);
+static GnomeHintsSettings *sharedInstance()
+{
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        return reinterpret_cast<GnomeHintsSettings *>(app->property(sharedInstanceProperty).value<quintptr>());
     }
+    return s_sharedInstance;
+}
 
-    argument.endMap();
-    return argument;
+static void setSharedInstance(GnomeHintsSettings *settings)
+{
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        app->setProperty(sharedInstanceProperty, settings ? QVariant::fromValue(reinterpret_cast<quintptr>(settings)) : QVariant());
+    }
+    s_sharedInstance = settings;
 }
 
-static inline bool checkUsePortalSupport()
+static const char *settingKeyNames[GnomeHintsSettings::SettingKeyCount] = {
+    "gtk-theme",
+    "icon-theme",
+    "cursor-blink",
+    "cursor-blink-time",
+    "cursor-blink-timeout",
+    "cursor-size",
+    "font-name",
+    "monospace-font-name",
+    "text-scaling-factor",
+    "font-antialiasing",
+    "font-hinting",
+    "font-rgba-order",
+    "enable-animations",
+    "titlebar-font",
+    "button-layout",
+    "double-click",
+    "drag-threshold"
+};
+
+static const quint32 snapshotMagic = 0x51475053; // QGPS
+static const quint32 snapshotVersion = 7;
+
+// Hints resolved from the settings, the rest of them are constant
+static const QPlatformTheme::ThemeHint snapshotHints[] = {
+    QPlatformTheme::CursorFlashTime,
+    QPlatformTheme::MouseDoubleClickInterval,
+    QPlatformTheme::MousePressAndHoldInterval,
+    QPlatformTheme::MouseDoubleClickDistance,
+    QPlatformTheme::StartDragDistance,
+    QPlatformTheme::PasswordMaskDelay,
+    QPlatformTheme::SystemIconThemeName,
+    QPlatformTheme::SystemIconFallbackThemeName,
+    QPlatformTheme::IconThemeSearchPaths,
+    QPlatformTheme::StyleNames
+};
+
+Q_STATIC_ASSERT(QPlatformTheme::MouseDoubleClickDistance < GnomeHintsSettings::ThemeHintCount);
+Q_STATIC_ASSERT(QPlatformTheme::PasswordMaskCharacter < GnomeHintsSettings::ThemeHintCount);
+Q_STATIC_ASSERT(QPlatformTheme::UiEffects < GnomeHintsSettings::ThemeHintCount);
+
+// Pending keys are collected in a bit mask
+Q_STATIC_ASSERT(GnomeHintsSettings::SettingKeyCount <= 32);
+
+static QString snapshotPath()
 {
-    return !QStandardPaths::locate(QStandardPaths::RuntimeLocation, QStringLiteral("flatpak-info")).isEmpty() || qEnvironmentVariableIsSet("SNAP");
+    const QString runtimeDir = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (runtimeDir.isEmpty()) {
+        return QString();
+    }
+
+    return runtimeDir + QStringLiteral("/qgnomeplatform-settings.cache");
 }
 
-void gtkMessageHandler(const gchar *log_domain,
-                       GLogLevelFlags log_level,
-                       const gchar *message,
-                       gpointer unused_data) {
-    /* Silence false-positive Gtk warnings (we are using Xlib to set
-     * the WM_TRANSIENT_FOR hint).
-     */
-    if (g_strcmp0(message, "GtkDialog mapped without a transient parent. "
-                           "This is discouraged.") != 0) {
-        /* For other messages, call the default handler. */
-        g_log_default_handler(log_domain, log_level, message, unused_data);
+// Describes everything the snapshot is computed from. The dconf database and the
+// xfconf channel files are replaced on every write, directories change their
+// modification time when themes are installed or removed.
+static QByteArray snapshotStamp()
+{
+    QByteArray stamp;
+    QDataStream stream(&stamp, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_5_9);
+
+    const char *environment[] = { "XDG_CURRENT_DESKTOP", "QGNOMEPLATFORM_SETTINGS_BACKEND", "XDG_DATA_DIRS", "XDG_CONFIG_DIRS", "GTK_THEME", "HOME",
+                                  "QGNOMEPLATFORM_REMOTE_SESSION", "XDG_SESSION_ID", "XRDP_SESSION", "DISPLAY",
+                                  "QGNOMEPLATFORM_POWER_SAVER" };
+    for (const char *name : environment) {
+        stream << qgetenv(name);
+    }
+
+    QStringList paths;
+    paths << QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation) + QStringLiteral("/dconf/user")
+          << QStringLiteral("/etc/dconf/db");
+    for (const QString &configDir : QStandardPaths::standardLocations(QStandardPaths::GenericConfigLocation)) {
+        // Written by xfconfd on every change of the Xfce settings
+        paths << configDir + QStringLiteral("/xfce4/xfconf/xfce-perchannel-xml/xsettings.xml")
+              << configDir + QStringLiteral("/xfce4/xfconf/xfce-perchannel-xml/xfwm4.xml");
+    }
+    for (const QString &configDir : QStandardPaths::standardLocations(QStandardPaths::GenericConfigLocation)) {
+        paths << configDir + QStringLiteral("/gtk-3.0/settings.ini");
+    }
+    paths << QDir::homePath() + QStringLiteral("/.icons");
+    for (const QString &dataDir : QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation)) {
+        paths << dataDir + QStringLiteral("/icons")
+              << dataDir + QStringLiteral("/themes")
+              << dataDir + QStringLiteral("/Kvantum");
+    }
+
+    for (const QString &path : paths) {
+        const QFileInfo info(path);
+        stream << path << (info.exists() ? info.lastModified().toMSecsSinceEpoch() : qint64(-1));
     }
+
+    return stamp;
 }
 
-GnomeHintsSettings::GnomeHintsSettings()
-    : QObject(0)
-    , m_usePortal(checkUsePortalSupport())
-    , m_gnomeDesktopSettings(g_settings_new("org.gnome.desktop.wm.preferences"))
-    , m_settings(g_settings_new("org.gnome.desktop.interface"))
+// Whether the session is displayed remotely. QGNOMEPLATFORM_REMOTE_SESSION set to 1 or 0
+// decides, otherwise ask logind through its session file, which is what its Remote
+// property is read from, and fall back to what remote sessions leave in the environment.
+static bool detectRemoteSession()
 {
-    gtk_init(nullptr, nullptr);
+    const QByteArray remoteSession = qgetenv("QGNOMEPLATFORM_REMOTE_SESSION");
+    if (!remoteSession.isEmpty()) {
+        return remoteSession != "0";
+    }
 
-    // Set log handler to suppress false GtkDialog warnings
-    g_log_set_handler("Gtk", G_LOG_LEVEL_MESSAGE, gtkMessageHandler, NULL);
+    const QByteArray sessionId = qgetenv("XDG_SESSION_ID");
+    if (!sessionId.isEmpty()) {
+        QFile sessionFile(QStringLiteral("/run/systemd/sessions/") + QFile::decodeName(sessionId));
+        if (sessionFile.open(QIODevice::ReadOnly)) {
+            while (!sessionFile.atEnd()) {
+                if (sessionFile.readLine().trimmed() == "REMOTE=1") {
+                    return true;
+                }
+            }
+        }
+    }
 
-    // Check if this is a Cinnamon session to use additionally a different setting scheme
-    if (qgetenv("XDG_CURRENT_DESKTOP").toLower() == QStringLiteral("x-cinnamon")) {
-        m_cinnamonSettings = g_settings_new("org.cinnamon.desktop.interface");
+    if (qEnvironmentVariableIsSet("XRDP_SESSION")) {
+        return true;
     }
 
-    if (m_usePortal) {
-        QDBusMessage message = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.portal.Desktop"),
-                                                              QStringLiteral("/org/freedesktop/portal/desktop"),
-                                                              QStringLiteral("org.freedesktop.portal.Settings"),
-                                                              QStringLiteral("ReadAll"));
-        message << QStringList{{QStringLiteral("org.gnome.desktop.interface")}, {QStringLiteral("org.gnome.desktop.wm.preferences")}};
+    // X11 display on another host, like with ssh -X
+    const QByteArray display = qgetenv("DISPLAY");
+    const QByteArray host = display.left(display.lastIndexOf(':'));
+    return !host.isEmpty() && host != "unix" && !host.startsWith('/');
+}
+
+// Values GTK would read from its settings.ini files, so that we don't need to initialize
+// GTK just to ask it. User configuration takes precedence over the system one.
+static QVariantMap gtkIniSettings()
+{
+    QStringList configDirs = QStandardPaths::standardLocations(QStandardPaths::GenericConfigLocation);
+    configDirs << QStringLiteral("/etc");
+
+    QVariantMap settings;
+    for (const QString &configDir : configDirs) {
+        const QString path = configDir + QStringLiteral("/gtk-3.0/settings.ini");
+        if (!QFile::exists(path)) {
+            continue;
+        }
 
-        // FIXME: async?
-        QDBusMessage resultMessage = QDBusConnection::sessionBus().call(message);
-        if (resultMessage.type() == QDBusMessage::ReplyMessage) {
-            QDBusArgument dbusArgument = resultMessage.arguments().at(0).value<QDBusArgument>();
-            dbusArgument >> m_portalSettings;
+        QSettings ini(path, QSettings::IniFormat);
+        ini.beginGroup(QStringLiteral("Settings"));
+        for (const QString &key : ini.childKeys()) {
+            if (!settings.contains(key)) {
+                settings.insert(key, ini.value(key));
+            }
         }
     }
 
+    return settings;
+}
+
+static int gtkIniSetting(const QVariantMap &settings, const QString &name, int defaultValue)
+{
+    bool ok = false;
+    const int value = settings.value(name).toInt(&ok);
+    return ok ? value : defaultValue;
+}
+
+GnomeHintsSettings::GnomeHintsSettings()
+    : QObject(0)
+    , m_backend(SettingsBackend::create(this))
+    , m_cursorBlinkTracker(new CursorBlinkTracker(this))
+    , m_lowBandwidth(detectRemoteSession())
+{
+    RuntimeStats::installExporter(this);
+
+    if (m_lowBandwidth) {
+        qCDebug(QGnomePlatform) << "Remote session, using the low bandwidth profile";
+    }
+
+    connect(m_backend, &SettingsBackend::valueChanged, this, &GnomeHintsSettings::backendValueChanged);
+
     m_hints[QPlatformTheme::DialogButtonBoxLayout] = QDialogButtonBox::GnomeLayout;
     m_hints[QPlatformTheme::DialogButtonBoxButtonsHaveIcons] = true;
     m_hints[QPlatformTheme::KeyboardScheme] = QPlatformTheme::GnomeKeyboardScheme;
     m_hints[QPlatformTheme::IconPixmapSizes] = QVariant::fromValue(QList<int>() << 512 << 256 << 128 << 64 << 32 << 22 << 16 << 8);
     m_hints[QPlatformTheme::PasswordMaskCharacter] = QVariant(QChar(0x2022));
 
-    // Watch for changes
-    QStringList watchListDesktopInterface = { "changed::gtk-theme", "changed::icon-theme", "changed::cursor-blink-time", "changed::font-name", "changed::monospace-font-name", "changed::cursor-size" };
-    for (const QString &watchedProperty : watchListDesktopInterface) {
-        g_signal_connect(m_settings, watchedProperty.toStdString().c_str(), G_CALLBACK(gsettingPropertyChanged), this);
+    // Changes are applied together on the next event loop iteration, or after the
+    // given delay to also merge changes which don't arrive at once
+    m_changeTimer.setSingleShot(true);
+    m_changeTimer.setInterval(qMax(0, qEnvironmentVariableIntValue("QGNOMEPLATFORM_CHANGE_DELAY")));
+    connect(&m_changeTimer, &QTimer::timeout, this, &GnomeHintsSettings::applyPendingChanges);
+
+    // Installed or removed icon and Kvantum themes
+    connect(&m_dataIndex, &XdgDataIndex::changed, this, [this] () {
+        queueChanges(DataDirsChange);
+    });
+
+    // Optionally turn the effects off while power-profiles-daemon is in power saver mode.
+    // Set to "session" to look for it, or something standing in for it, on the session bus.
+    const QByteArray powerSaver = qgetenv("QGNOMEPLATFORM_POWER_SAVER");
+    if (!powerSaver.isEmpty() && powerSaver != "0") {
+        m_powerProfiles = new PowerProfileMonitor(powerSaver == "session" ? QDBusConnection::sessionBus() : QDBusConnection::systemBus(), this);
+        connect(m_powerProfiles, &PowerProfileMonitor::powerSaverChanged, this, [this] () {
+            queueChanges(AnimationsChange);
+        });
+    }
 
-        // Additionally watch Cinnamon configuration
-        if (m_cinnamonSettings) {
-            g_signal_connect(m_cinnamonSettings, watchedProperty.toStdString().c_str(), G_CALLBACK(gsettingPropertyChanged), this);
+    // Reuse what another process already resolved from the same configuration, as
+    // long as the backend's values don't arrive later
+    const bool useSnapshot = m_backend->isCacheable() && !qEnvironmentVariableIsSet("QGNOMEPLATFORM_NO_SETTINGS_CACHE");
+    const QByteArray stamp = useSnapshot ? snapshotStamp() : QByteArray();
+
+    // Only what the first frame needs is loaded right away: fonts, palette and style.
+    // The snapshot is written once the rest is loaded too.
+    if (!useSnapshot || !loadSnapshot(stamp)) {
+        loadFonts();
+        loadStaticHints();
+        loadTheme();
+        loadPalette();
+
+        if (useSnapshot) {
+            m_snapshotStamp = stamp;
         }
+    } else {
+        // The effects depend on the power profile of this moment, they're never cached.
+        // The snapshot has the settings they're computed from, the backend isn't needed.
+        loadAnimations();
+    }
+
+    publishSnapshot();
+
+    // The rest follows after the first window was exposed, or after a while in case
+    // the application doesn't show any
+    m_deferredTimer.setSingleShot(true);
+    m_deferredTimer.setInterval(1000);
+    connect(&m_deferredTimer, &QTimer::timeout, this, &GnomeHintsSettings::loadDeferred);
+    m_deferredTimer.start();
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        app->installEventFilter(this);
+    }
+
+    m_cursorBlinkTracker->setBlinking(m_hints[QPlatformTheme::CursorFlashTime].toInt(), m_cursorBlinkTimeout);
+}
+
+GnomeHintsSettings::~GnomeHintsSettings()
+{
+    if (!m_deferredLoaded && QCoreApplication::instance()) {
+        QCoreApplication::instance()->removeEventFilter(this);
     }
 
-    QStringList watchListWmPreferences = { "changed::titlebar-font", "changed::button-layout" };
-    for (const QString &watchedProperty : watchListWmPreferences) {
-        g_signal_connect(m_gnomeDesktopSettings, watchedProperty.toStdString().c_str(), G_CALLBACK(gsettingPropertyChanged), this);
+    delete m_backend;
+
+    qDeleteAll(m_fontCache);
+}
+
+bool GnomeHintsSettings::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::Expose && !m_deferredLoaded) {
+        // Painting happens while the expose event is handled, continue right after
+        QCoreApplication::instance()->removeEventFilter(this);
+        m_deferredTimer.start(0);
     }
 
-    if (m_usePortal) {
-        QDBusConnection::sessionBus().connect(QString(), QStringLiteral("/org/freedesktop/portal/desktop"), QStringLiteral("org.freedesktop.portal.Settings"),
-                                              QStringLiteral("SettingChanged"), this, SLOT(portalSettingChanged(QString,QString,QDBusVariant)));
+    return QObject::eventFilter(watched, event);
+}
+
+void GnomeHintsSettings::loadDeferred()
+{
+    PhaseTraceScope trace("GnomeHintsSettings::loadDeferred");
+
+    if (m_deferredLoaded) {
+        return;
+    }
+    m_deferredLoaded = true;
+    m_deferredTimer.stop();
+    if (QCoreApplication *app = QCoreApplication::instance()) {
+        app->removeEventFilter(this);
     }
 
     if (!QX11Info::isPlatformX11())
         cursorSizeChanged();
 
-    loadFonts();
-    loadPalette();
-    loadStaticHints();
-    loadTheme();
-    loadTitlebar();
+    Changes changes;
+
+    // Building the index also starts watching the data directories. Dropping the
+    // directories which don't exist from the paths isn't a change worth announcing.
+    const QStringList iconThemePaths = m_dataIndex.iconThemePaths();
+    const QStringList oldIconThemePaths = m_hints[QPlatformTheme::IconThemeSearchPaths].toStringList();
+    const bool iconThemePathsChanged = oldIconThemePaths != iconThemePaths;
+    if (iconThemePathsChanged) {
+        m_hints[QPlatformTheme::IconThemeSearchPaths] = iconThemePaths;
+
+        int found = 0;
+        for (const QString &path : oldIconThemePaths) {
+            if (found < iconThemePaths.count() && iconThemePaths.at(found) == path) {
+                ++found;
+            }
+        }
+        if (found != iconThemePaths.count()) {
+            changes |= DataDirsChange;
+        }
+    }
+
+    if (!m_titlebarLoaded) {
+        const TitlebarButtons titlebarButtons = m_titlebarButtons;
+        const TitlebarButtonsPlacement titlebarButtonPlacement = m_titlebarButtonPlacement;
+        loadTitlebar();
+        if (m_titlebarButtons != titlebarButtons || m_titlebarButtonPlacement != titlebarButtonPlacement) {
+            changes |= TitlebarChange;
+        }
+    }
+
+    syncKvantumConfig();
+
+    if (!m_snapshotStamp.isEmpty()) {
+        saveSnapshot(m_snapshotStamp);
+        m_snapshotStamp.clear();
+    }
+
+    // Changes made since the values were read, or since the snapshot was written,
+    // arrive like any other change from here on
+    m_backend->watch(m_values);
+
+    // Whatever turned out different is applied at once, like any other change
+    if (changes) {
+        qCDebug(QGnomePlatform) << "Applying deferred settings: " << changes;
+        publishSnapshot();
+        Q_EMIT settingsChanged(changes);
+        updateApplication(changes);
+    } else if (iconThemePathsChanged) {
+        publishSnapshot();
+    }
 }
 
-GnomeHintsSettings::~GnomeHintsSettings()
+GnomeHintsSettings *GnomeHintsSettings::acquire()
 {
-    qDeleteAll(m_fonts);
-    delete m_palette;
+    GnomeHintsSettings *settings = sharedInstance();
+    if (!settings) {
+        PhaseTraceScope trace("GnomeHintsSettings");
+        settings = new GnomeHintsSettings;
+        setSharedInstance(settings);
+    }
+
+    settings->m_refCount++;
+    return settings;
+}
+
+void GnomeHintsSettings::release(GnomeHintsSettings *settings)
+{
+    if (!settings) {
+        return;
+    }
+
+    if (--settings->m_refCount == 0) {
+        if (sharedInstance() == settings) {
+            setSharedInstance(nullptr);
+        }
+        delete settings;
+    }
+}
+
+const char *GnomeHintsSettings::settingKeyName(SettingKey key)
+{
+    return settingKeyNames[key];
+}
+
+GnomeHintsSettings::SettingKey GnomeHintsSettings::settingKeyFromName(const char *name)
+{
+    // Built once, every change notification of every backend goes through here
+    static const QHash<QByteArray, SettingKey> keys = [] () {
+        QHash<QByteArray, SettingKey> keys;
+        for (int key = 0; key < SettingKeyCount; ++key) {
+            keys.insert(QByteArray(settingKeyNames[key]), static_cast<SettingKey>(key));
+        }
+        return keys;
+    }();
+
+    return keys.value(QByteArray::fromRawData(name, qstrlen(name)), SettingKeyCount);
+}
+
+int GnomeHintsSettings::subscribe(SettingKey key, const QObject *context, const SettingCallback &callback)
+{
+    if (key >= SettingKeyCount || !callback) {
+        return 0;
+    }
+
+    // Old values are only tracked for the keys somebody is interested in
+    if (m_subscriptions[key].isEmpty()) {
+        m_subscribedValues[key] = settingValue(key);
+    }
+
+    const int id = m_nextSubscriptionId++;
+
+    // Gone with the context, windows come and go while the settings stay
+    QMetaObject::Connection contextConnection;
+    if (context) {
+        contextConnection = connect(context, &QObject::destroyed, this, [this, id] () {
+            unsubscribe(id);
+        });
+    }
+
+    m_subscriptions[key].append({ id, context, callback, contextConnection });
+    return id;
+}
+
+void GnomeHintsSettings::unsubscribe(int id)
+{
+    for (QVector<Subscription> &subscriptions : m_subscriptions) {
+        for (int i = 0; i < subscriptions.count(); ++i) {
+            if (subscriptions.at(i).id == id) {
+                disconnect(subscriptions.at(i).contextConnection);
+                subscriptions.remove(i);
+                return;
+            }
+        }
+    }
+}
+
+const QVariant &GnomeHintsSettings::settingValue(SettingKey key)
+{
+    if (!m_valuesLoaded) {
+        m_backend->readAll(m_values);
+        m_valuesLoaded = true;
+    }
+
+    return m_values[key];
+}
+
+void GnomeHintsSettings::notifySubscribers(quint32 keys)
+{
+    for (int key = 0; key < SettingKeyCount; ++key) {
+        if (!(keys & (1u << key)) || m_subscriptions[key].isEmpty()) {
+            continue;
+        }
+
+        const QVariant newValue = settingValue(static_cast<SettingKey>(key));
+        const QVariant oldValue = m_subscribedValues[key];
+        if (newValue == oldValue) {
+            continue;
+        }
+        m_subscribedValues[key] = newValue;
+
+        // Callbacks may subscribe or unsubscribe, work on a copy. One may also
+        // destroy the context of a later one.
+        const QVector<Subscription> subscriptions = m_subscriptions[key];
+        for (const Subscription &subscription : subscriptions) {
+            if (subscription.context) {
+                subscription.callback(oldValue, newValue);
+            }
+        }
+    }
 }
 
-void GnomeHintsSettings::gsettingPropertyChanged(GSettings *settings, gchar *key, GnomeHintsSettings *gnomeHintsSettings)
+void GnomeHintsSettings::backendValueChanged(SettingKey key, const QVariant &value)
 {
-    Q_UNUSED(settings);
+    RuntimeStats::count(RuntimeStats::ChangesReceived);
+
+    // Until the values are read for the first time, the change only needs to be applied
+    if (m_valuesLoaded) {
+        if (m_values[key] == value) {
+            return;
+        }
+        m_values[key] = value;
+    }
 
-    const QString changedProperty = key;
+    settingChanged(key);
+}
 
+GnomeHintsSettings::Changes GnomeHintsSettings::changesForKey(SettingKey key)
+{
+    switch (key) {
     // Org.gnome.desktop.interface
-    if (changedProperty == QStringLiteral("gtk-theme")) {
-        gnomeHintsSettings->themeChanged();
-    } else if (changedProperty == QStringLiteral("icon-theme")) {
-        gnomeHintsSettings->iconsChanged();
-    } else if (changedProperty == QStringLiteral("cursor-blink-time")) {
-        gnomeHintsSettings->cursorBlinkTimeChanged();
-    } else if (changedProperty == QStringLiteral("font-name")) {
-        gnomeHintsSettings->fontChanged();
-    } else if (changedProperty == QStringLiteral("monospace-font-name")) {
-        gnomeHintsSettings->fontChanged();
-    } else if (changedProperty == QStringLiteral("cursor-size")) {
-        if (!QX11Info::isPlatformX11())
-            gnomeHintsSettings->cursorSizeChanged();
+    case GtkThemeKey:
+        return ThemeChange;
+    case IconThemeKey:
+        return IconThemeChange;
+    case CursorBlinkKey:
+    case CursorBlinkTimeKey:
+    case CursorBlinkTimeoutKey:
+        return CursorBlinkChange;
+    case CursorSizeKey:
+        return CursorSizeChange;
+    case FontNameKey:
+    case MonospaceFontNameKey:
+    case TextScalingFactorKey:
+    case FontAntialiasingKey:
+    case FontHintingKey:
+    case FontRgbaOrderKey:
+        return FontChange;
+    case EnableAnimationsKey:
+        return AnimationsChange;
     // Org.gnome.wm.preferences
-    } else if (changedProperty == QStringLiteral("titlebar-font")) {
-        gnomeHintsSettings->fontChanged();
-    } else if (changedProperty == QStringLiteral("button-layout")) {
-        gnomeHintsSettings->loadTitlebar();
-    // Fallback
-    } else {
-        qCDebug(QGnomePlatform) << "GSetting property change: " << key;
+    case TitlebarFontKey:
+        return FontChange;
+    case ButtonLayoutKey:
+        return TitlebarChange;
+    // Org.gnome.desktop.peripherals.mouse
+    case DoubleClickTimeKey:
+    case DragThresholdKey:
+        return GtkHintsChange;
+    case SettingKeyCount:
+        break;
     }
+
+    return Changes();
 }
 
-void GnomeHintsSettings::cursorBlinkTimeChanged()
+void GnomeHintsSettings::settingChanged(SettingKey key)
 {
-    int cursorBlinkTime = getSettingsProperty<int>(QStringLiteral("cursor-blink-time"));
-    if (cursorBlinkTime >= 100) {
-        qCDebug(QGnomePlatform) << "Cursor blink time changed to: " << cursorBlinkTime;
-        m_hints[QPlatformTheme::CursorFlashTime] = cursorBlinkTime;
-    } else {
-        qCDebug(QGnomePlatform) << "Cursor blink time changed to: 1200";
-        m_hints[QPlatformTheme::CursorFlashTime] = 1200;
+    // A single theme switch changes several keys in a row, collect them and apply
+    // them all together once the current event loop iteration is done
+    m_pendingKeys |= 1u << key;
+    queueChanges(changesForKey(key));
+}
+
+void GnomeHintsSettings::queueChanges(Changes changes)
+{
+    m_pendingChanges |= changes;
+
+    if (m_pendingChanges && !m_changeTimer.isActive()) {
+        m_changeTimer.start();
     }
+}
+
+void GnomeHintsSettings::applyPendingChanges()
+{
+    PhaseTraceScope trace("GnomeHintsSettings::applyPendingChanges");
 
-    //If we are not a QApplication, means that we are a QGuiApplication, then we do nothing.
-    if (!qobject_cast<QApplication *>(QCoreApplication::instance())) {
+    const Changes changes = m_pendingChanges;
+    const quint32 keys = m_pendingKeys;
+    m_pendingChanges = Changes();
+    m_pendingKeys = 0;
+
+    if (!changes) {
         return;
     }
 
-    QWidgetList widgets = QApplication::allWidgets();
-    for (QWidget *widget : widgets) {
-        if (qobject_cast<QToolBar *>(widget) || qobject_cast<QMainWindow *>(widget)) {
-            QEvent event(QEvent::StyleChange);
-            QApplication::sendEvent(widget, &event);
+    RuntimeStats::count(RuntimeStats::ChangesApplied);
+    qCDebug(QGnomePlatform) << "Applying settings changes: " << changes;
+
+    if (changes & FontChange) {
+        loadFonts();
+    }
+
+    if (changes & ThemeChange) {
+        loadTheme();
+        loadPalette();
+    }
+
+    if (changes & IconThemeChange) {
+        loadIconTheme();
+    }
+
+    if (changes & DataDirsChange) {
+        m_hints[QPlatformTheme::IconThemeSearchPaths] = m_dataIndex.iconThemePaths();
+        if (!(changes & ThemeChange)) {
+            // The Kvantum theme matching the Gtk theme might have been installed
+            loadTheme();
         }
     }
+
+    if (changes & CursorBlinkChange) {
+        loadCursorBlinkTime();
+    }
+
+    if ((changes & CursorSizeChange) && !QX11Info::isPlatformX11()) {
+        cursorSizeChanged();
+    }
+
+    if (changes & TitlebarChange) {
+        loadTitlebar();
+    }
+
+    if (changes & GtkHintsChange) {
+        loadGtkHints();
+    }
+
+    if (changes & AnimationsChange) {
+        loadAnimations();
+    }
+
+    publishSnapshot();
+
+    // Let the platform theme pick up the new values first, updating the application
+    // makes Qt query them
+    Q_EMIT settingsChanged(changes);
+    notifySubscribers(keys);
+
+    updateApplication(changes);
 }
 
-void GnomeHintsSettings::cursorSizeChanged()
+void GnomeHintsSettings::publishSnapshot()
 {
-    int cursorSize = getSettingsProperty<int>(QStringLiteral("cursor-size"));
-    qputenv("XCURSOR_SIZE", QString::number(cursorSize).toUtf8());
+    // Only the GUI thread changes the settings
+    Snapshot *snapshot = new Snapshot;
+    snapshot->generation = m_snapshot.load()->generation + 1;
+    for (int hint = 0; hint < ThemeHintCount; ++hint) {
+        snapshot->hints[hint] = m_hints[hint];
+    }
+    snapshot->fonts = m_fonts;
+    snapshot->gtkTheme = m_gtkTheme;
+    snapshot->gtkThemeDarkVariant = m_gtkThemeDarkVariant;
+    snapshot->titlebarButtons = m_titlebarButtons;
+    snapshot->titlebarButtonPlacement = m_titlebarButtonPlacement;
+    snapshot->gtkPalette = m_gtkPalette;
+    snapshot->lowBandwidth = m_lowBandwidth;
+
+    m_snapshot.publish(snapshot);
 }
 
-void GnomeHintsSettings::fontChanged()
+void GnomeHintsSettings::updateApplication(Changes changes)
 {
-    const QFont oldSysFont = *m_fonts[QPlatformTheme::SystemFont];
-    loadFonts();
+    QApplication *application = qobject_cast<QApplication *>(QCoreApplication::instance());
+
+    // QApplication::setPalette and QGuiApplication::setPalette are different functions
+    // and non virtual. Call the correct one. Both propagate the change to every widget
+    // or window which doesn't have its own font or palette.
+    if (changes & FontChange) {
+        RuntimeStats::count(RuntimeStats::WidgetInvalidations);
+        if (application) {
+            QApplication::setFont(*font(QPlatformTheme::SystemFont));
+        } else {
+            QGuiApplication::setFont(*font(QPlatformTheme::SystemFont));
+        }
+    }
 
-    if (qobject_cast<QApplication *>(QCoreApplication::instance())) {
-        QApplication::setFont(*m_fonts[QPlatformTheme::SystemFont]);
-        QWidgetList widgets = QApplication::allWidgets();
-        for (QWidget *widget : widgets) {
-            if (widget->font() == oldSysFont) {
-                widget->setFont(*m_fonts[QPlatformTheme::SystemFont]);
+    bool styleChanged = false;
+    if (changes & ThemeChange) {
+        RuntimeStats::count(RuntimeStats::WidgetInvalidations);
+        if (application) {
+            QApplication::setPalette(m_gtkPalette->palette());
+            if (QStyleFactory::keys().contains(m_gtkTheme, Qt::CaseInsensitive)) {
+                QApplication::setStyle(m_gtkTheme);
+                styleChanged = true;
+            }
+        } else if (qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
+            QGuiApplication::setPalette(m_gtkPalette->palette());
+        }
+    }
+
+    if (changes & CursorBlinkChange) {
+        QGuiApplication::styleHints()->setCursorFlashTime(m_hints[QPlatformTheme::CursorFlashTime].toInt());
+        m_cursorBlinkTracker->setBlinking(m_hints[QPlatformTheme::CursorFlashTime].toInt(), m_cursorBlinkTimeout);
+    }
+
+    if ((changes & AnimationsChange) && application) {
+        const int effects = m_hints[QPlatformTheme::UiEffects].toInt();
+        const struct {
+            Qt::UIEffect effect;
+            QPlatformTheme::UiEffect flag;
+        } uiEffects[] = {
+            { Qt::UI_General, QPlatformTheme::GeneralUiEffect },
+            { Qt::UI_AnimateMenu, QPlatformTheme::AnimateMenuUiEffect },
+            { Qt::UI_FadeMenu, QPlatformTheme::FadeMenuUiEffect },
+            { Qt::UI_AnimateCombo, QPlatformTheme::AnimateComboUiEffect },
+            { Qt::UI_AnimateTooltip, QPlatformTheme::AnimateTooltipUiEffect },
+            { Qt::UI_FadeTooltip, QPlatformTheme::FadeTooltipUiEffect },
+            { Qt::UI_AnimateToolBox, QPlatformTheme::AnimateToolBoxUiEffect }
+        };
+        for (const auto &uiEffect : uiEffects) {
+            QApplication::setEffectEnabled(uiEffect.effect, effects & uiEffect.flag);
+        }
+    }
+
+    if (changes & (IconThemeChange | DataDirsChange)) {
+        RuntimeStats::count(RuntimeStats::WidgetInvalidations);
+
+        // Makes Qt reload the system icon theme and the rest of the theme hints
+        QWindowSystemInterface::handleThemeChange(nullptr);
+
+        // Setting a new style already repolished every widget. Otherwise only main windows
+        // and toolbars need to know, to pick up the icon size from the new theme. Toolbars
+        // in a main window follow its icon size, so only top level ones are interesting.
+        if (application && !styleChanged) {
+            const QWidgetList widgets = QApplication::topLevelWidgets();
+            for (QWidget *widget : widgets) {
+                if (qobject_cast<QToolBar *>(widget) || qobject_cast<QMainWindow *>(widget)) {
+                    QEvent event(QEvent::StyleChange);
+                    QApplication::sendEvent(widget, &event);
+                }
             }
         }
-    } else {
-        QGuiApplication::setFont(*m_fonts[QPlatformTheme::SystemFont]);
     }
 }
 
-void GnomeHintsSettings::iconsChanged()
+void GnomeHintsSettings::cursorSizeChanged()
 {
-    QString systemIconTheme = getSettingsProperty<QString>(QStringLiteral("icon-theme"));
-    if (!systemIconTheme.isEmpty()) {
-        qCDebug(QGnomePlatform) << "Icon theme changed to: " << systemIconTheme;
-        m_hints[QPlatformTheme::SystemIconThemeName] = systemIconTheme;
-    } else {
-        qCDebug(QGnomePlatform) << "Icon theme changed to: Adwaita";
-        m_hints[QPlatformTheme::SystemIconThemeName] = "Adwaita";
-    }
+    int cursorSize = getSettingsProperty<int>(CursorSizeKey);
+    qputenv("XCURSOR_SIZE", QString::number(cursorSize).toUtf8());
+}
 
-    //If we are not a QApplication, means that we are a QGuiApplication, then we do nothing.
-    if (!qobject_cast<QApplication *>(QCoreApplication::instance())) {
+void GnomeHintsSettings::loadCursorBlinkTime()
+{
+    PhaseTraceScope trace("GnomeHintsSettings::loadCursorBlinkTime");
+
+    bool ok = false;
+    const bool cursorBlink = getSettingsProperty<bool>(CursorBlinkKey, &ok);
+    if (ok && !cursorBlink) {
+        // Qt shows the cursor without blinking for a flash time of 0
+        qCDebug(QGnomePlatform) << "Cursor blinking disabled";
+        m_hints[QPlatformTheme::CursorFlashTime] = 0;
+        m_cursorBlinkTimeout = 0;
         return;
     }
 
-    QWidgetList widgets = QApplication::allWidgets();
-    for (QWidget *widget : widgets) {
-        if (qobject_cast<QToolBar *>(widget) || qobject_cast<QMainWindow *>(widget)) {
-            QEvent event(QEvent::StyleChange);
-            QApplication::sendEvent(widget, &event);
-        }
+    int cursorBlinkTime = getSettingsProperty<int>(CursorBlinkTimeKey);
+    if (cursorBlinkTime < 100) {
+        cursorBlinkTime = 1200;
+    }
+
+    // Fewer cursor repaints to send over the network
+    if (m_lowBandwidth) {
+        cursorBlinkTime *= 2;
     }
+
+    qCDebug(QGnomePlatform) << "Cursor blink time: " << cursorBlinkTime;
+    m_hints[QPlatformTheme::CursorFlashTime] = cursorBlinkTime;
+
+    // In seconds, GTK stops blinking after 10 of them by default
+    const int cursorBlinkTimeout = getSettingsProperty<int>(CursorBlinkTimeoutKey, &ok);
+    m_cursorBlinkTimeout = ok ? qMax(0, cursorBlinkTimeout) * 1000 : 10000;
+    qCDebug(QGnomePlatform) << "Cursor blink timeout: " << m_cursorBlinkTimeout;
 }
 
-void GnomeHintsSettings::themeChanged()
+void GnomeHintsSettings::loadAnimations()
 {
-    loadPalette();
-    loadTheme();
+    PhaseTraceScope trace("GnomeHintsSettings::loadAnimations");
 
-    // QApplication::setPalette and QGuiApplication::setPalette are different functions
-    // and non virtual. Call the correct one
-    if (qobject_cast<QApplication *>(QCoreApplication::instance())) {
-        QApplication::setPalette(*m_palette);
-        if (QStyleFactory::keys().contains(m_gtkTheme, Qt::CaseInsensitive))
-            QApplication::setStyle(m_gtkTheme);
-    } else if (qobject_cast<QGuiApplication *>(QCoreApplication::instance())) {
-        QGuiApplication::setPalette(*m_palette);
+    bool ok = false;
+    bool enableAnimations = getSettingsProperty<bool>(EnableAnimationsKey, &ok);
+    if (!ok) {
+        enableAnimations = true;
+    }
+
+    if (m_powerProfiles && m_powerProfiles->isPowerSaver()) {
+        qCDebug(QGnomePlatform) << "Power saver profile active, disabling effects";
+        enableAnimations = false;
+    }
+
+    // Every animation frame would be sent over the network
+    if (m_lowBandwidth) {
+        enableAnimations = false;
+    }
+
+    qCDebug(QGnomePlatform) << "Enable animations: " << enableAnimations;
+
+    // What GTK animates, menus and combo boxes slide in and tooltips fade
+    const int effects = QPlatformTheme::GeneralUiEffect | QPlatformTheme::AnimateMenuUiEffect | QPlatformTheme::AnimateComboUiEffect
+                      | QPlatformTheme::FadeTooltipUiEffect | QPlatformTheme::AnimateToolBoxUiEffect;
+    m_hints[QPlatformTheme::UiEffects] = enableAnimations ? effects : 0;
+}
+
+void GnomeHintsSettings::loadIconTheme()
+{
+    PhaseTraceScope trace("GnomeHintsSettings::loadIconTheme");
+
+    QString systemIconTheme = getSettingsProperty<QString>(IconThemeKey);
+    if (!systemIconTheme.isEmpty()) {
+        qCDebug(QGnomePlatform) << "Icon theme: " << systemIconTheme;
+        m_hints[QPlatformTheme::SystemIconThemeName] = systemIconTheme;
+    } else {
+        m_hints[QPlatformTheme::SystemIconThemeName] = "Adwaita";
     }
 }
 
 void GnomeHintsSettings::loadTitlebar()
 {
-    const QString buttonLayout = getSettingsProperty<QString>("button-layout");
+    PhaseTraceScope trace("GnomeHintsSettings::loadTitlebar");
+
+    m_titlebarLoaded = true;
+
+    const QString buttonLayout = getSettingsProperty<QString>(ButtonLayoutKey);
 
     if (buttonLayout.isEmpty()) {
         return;
@@ -307,9 +875,11 @@ void GnomeHintsSettings::loadTitlebar()
 
 void GnomeHintsSettings::loadTheme()
 {
-    // g_object_get(gtk_settings_get_default(), "gtk-theme-name", &m_gtkTheme, NULL);
-    m_gtkTheme = getSettingsProperty<QString>(QStringLiteral("gtk-theme"));
-    g_object_get(gtk_settings_get_default(), "gtk-application-prefer-dark-theme", &m_gtkThemeDarkVariant, NULL);
+    PhaseTraceScope trace("GnomeHintsSettings::loadTheme");
+
+    m_gtkTheme = getSettingsProperty<QString>(GtkThemeKey);
+    m_gtkThemeDarkVariant = gtkIniSettings().value(QStringLiteral("gtk-application-prefer-dark-theme")).toBool()
+                         || qgetenv("GTK_THEME").endsWith(":dark");
 
     if (m_gtkTheme.isEmpty()) {
         qCWarning(QGnomePlatform) << "Couldn't get current gtk theme!";
@@ -329,11 +899,14 @@ void GnomeHintsSettings::loadTheme()
     styleNames << m_gtkTheme;
 
     // Detect if we have a Kvantum theme for this Gtk theme
-    QString kvTheme = kvantumThemeForGtkTheme();
+    m_kvantumTheme = m_dataIndex.kvantumThemeForGtkTheme(m_gtkTheme);
 
-    if (!kvTheme.isEmpty()) {
-        // Found matching Kvantum theme, configure user's Kvantum setting to use this
-        configureKvantum(kvTheme);
+    if (!m_kvantumTheme.isEmpty()) {
+        // Found matching Kvantum theme, configure user's Kvantum setting to use this.
+        // Not while starting, the first frame doesn't depend on it.
+        if (m_deferredLoaded) {
+            syncKvantumConfig();
+        }
 
         if (m_gtkThemeDarkVariant) {
             styleNames << QStringLiteral("kvantum-dark");
@@ -352,187 +925,370 @@ void GnomeHintsSettings::loadTheme()
     m_hints[QPlatformTheme::StyleNames] = styleNames;
 }
 
-void GnomeHintsSettings::loadFonts()
+void GnomeHintsSettings::syncKvantumConfig()
 {
-    qDeleteAll(m_fonts);
-    m_fonts.clear();
+    PhaseTraceScope trace("GnomeHintsSettings::syncKvantumConfig");
 
-    const QStringList fontTypes { "font-name", "monospace-font-name", "titlebar-font" };
+    // Written in the background, nothing waits on the file
+    if (!m_kvantumTheme.isEmpty()) {
+        KvantumConfigWriter::setTheme(m_kvantumTheme);
+    }
+}
+
+void GnomeHintsSettings::loadFonts()
+{
+    PhaseTraceScope trace("GnomeHintsSettings::loadFonts");
 
-    for (const QString &fontType : fontTypes) {
-        const QString fontName = getSettingsProperty<QString>(fontType);
+    m_fonts.clear();
+    loadFontRendering();
+
+    // Accessibility text scaling, GNOME limits it to this range too
+    bool ok = false;
+    qreal scale = getSettingsProperty<qreal>(TextScalingFactorKey, &ok);
+    scale = ok && scale > 0 ? qBound(0.5, scale, 3.0) : 1.0;
+    qCDebug(QGnomePlatform) << "Text scaling factor: " << scale;
+
+    const struct {
+        SettingKey key;
+        QPlatformTheme::Font type;
+    } fontTypes[] = {
+        { FontNameKey, QPlatformTheme::SystemFont },
+        { MonospaceFontNameKey, QPlatformTheme::FixedFont },
+        { TitlebarFontKey, QPlatformTheme::TitleBarFont }
+    };
+
+    for (const auto &fontType : fontTypes) {
+        const QString fontName = getSettingsProperty<QString>(fontType.key);
         if (fontName.isEmpty()) {
-            qCWarning(QGnomePlatform) << "Couldn't get " << fontType;
+            qCWarning(QGnomePlatform) << "Couldn't get " << settingKeyName(fontType.key);
         } else {
-            bool bold = false;
-            int fontSize;
-            QString name;
-            QRegExp re("(.+)[ \t]+([0-9]+)");
-            if (re.indexIn(fontName) == 0) {
-                fontSize = re.cap(2).toInt();
-                name = re.cap(1);
-                // Bold is most likely not part of the name
-                if (name.endsWith(QStringLiteral(" Bold"))) {
-                    bold = true;
-                    name = name.remove(QStringLiteral(" Bold"));
-                }
+            QFont *font = cachedFont(fontName, scale);
+            m_fonts[fontType.type] = font;
+            qCDebug(QGnomePlatform) << settingKeyName(fontType.key) << ": " << *font;
+        }
+    }
 
-                QFont *font = new QFont(name, fontSize, bold ? QFont::Bold : QFont::Normal);
-                if (fontType == QStringLiteral("font-name")) {
-                    m_fonts[QPlatformTheme::SystemFont] = font;
-                    qCDebug(QGnomePlatform) << "Font name: " << name << " (size " << fontSize << ")";
-                } else if (fontType == QStringLiteral("monospace-font-name")) {
-                    m_fonts[QPlatformTheme::FixedFont] = font;
-                    qCDebug(QGnomePlatform) << "Monospace font name: " << name << " (size " << fontSize << ")";
-                } else if (fontType == QStringLiteral("titlebar-font")) {
-                    m_fonts[QPlatformTheme::TitleBarFont] = font;
-                    qCDebug(QGnomePlatform) << "TitleBar font name: " << name << " (size " << fontSize << ")";
-                }
-            } else {
-                if (fontType == QStringLiteral("font-name")) {
-                    m_fonts[QPlatformTheme::SystemFont] = new QFont(fontName);
-                    qCDebug(QGnomePlatform) << "Font name: " << fontName;
-                } else if (fontType == QStringLiteral("monospace-font-name")) {
-                    m_fonts[QPlatformTheme::FixedFont] = new QFont(fontName);
-                    qCDebug(QGnomePlatform) << "Monospace font name: " << fontName;
-                } else if (fontType == QStringLiteral("titlebar-font")) {
-                    m_fonts[QPlatformTheme::TitleBarFont] = new QFont(fontName);
-                    qCDebug(QGnomePlatform) << "TitleBar font name: " << fontName;
-                }
-            }
+    // GTK has no separate fonts for these, it uses the Pango "small" and "x-small"
+    // sizes of the interface font. Menus use the interface font as it is.
+    const QString systemFontName = getSettingsProperty<QString>(FontNameKey);
+    if (!systemFontName.isEmpty()) {
+        m_fonts[QPlatformTheme::SmallFont] = cachedFont(systemFontName, scale * PANGO_SCALE_SMALL);
+        m_fonts[QPlatformTheme::MiniFont] = cachedFont(systemFontName, scale * PANGO_SCALE_X_SMALL);
+
+        const QPlatformTheme::Font menuFonts[] = { QPlatformTheme::MenuFont, QPlatformTheme::MenuBarFont, QPlatformTheme::MenuItemFont };
+        for (QPlatformTheme::Font type : menuFonts) {
+            m_fonts[type] = m_fonts[QPlatformTheme::SystemFont];
         }
     }
 }
 
-void GnomeHintsSettings::loadPalette()
+void GnomeHintsSettings::loadFontRendering()
 {
-    if (m_palette) {
-        delete m_palette;
-        m_palette = nullptr;
+    PhaseTraceScope trace("GnomeHintsSettings::loadFontRendering");
+
+    // Rendering the fonts the way GTK does keeps Qt from rasterizing the same glyphs
+    // a second time, differently, in applications using both
+    const QString antialiasing = getSettingsProperty<QString>(FontAntialiasingKey);
+    const QString hinting = getSettingsProperty<QString>(FontHintingKey);
+    const QString rgbaOrder = getSettingsProperty<QString>(FontRgbaOrderKey);
+
+    // The subpixel order itself comes from the screen, Qt reads it from the X resources
+    // or from the Wayland output, only whether to use it is up to us
+    if (antialiasing == QStringLiteral("none")) {
+        m_fontAntialiasing = QFont::NoAntialias;
+    } else if (antialiasing == QStringLiteral("grayscale") || (antialiasing == QStringLiteral("rgba") && rgbaOrder == QStringLiteral("none"))) {
+        m_fontAntialiasing = QFont::NoSubpixelAntialias;
+    } else {
+        m_fontAntialiasing = QFont::PreferDefault;
     }
 
-    m_palette = new QPalette();
+    if (hinting == QStringLiteral("none")) {
+        m_fontHinting = QFont::PreferNoHinting;
+    } else if (hinting == QStringLiteral("slight")) {
+        m_fontHinting = QFont::PreferVerticalHinting;
+    } else if (hinting == QStringLiteral("medium") || hinting == QStringLiteral("full")) {
+        m_fontHinting = QFont::PreferFullHinting;
+    } else {
+        m_fontHinting = QFont::PreferDefaultHinting;
+    }
+
+    qCDebug(QGnomePlatform) << "Font antialiasing: " << antialiasing << ", hinting: " << hinting << ", subpixel order: " << rgbaOrder;
 }
 
-void GnomeHintsSettings::loadStaticHints() {
-    int cursorBlinkTime = getSettingsProperty<int>(QStringLiteral("cursor-blink-time"));
-    if (cursorBlinkTime >= 100) {
-        qCDebug(QGnomePlatform) << "Cursor blink time: " << cursorBlinkTime;
-        m_hints[QPlatformTheme::CursorFlashTime] = cursorBlinkTime;
+QFont *GnomeHintsSettings::cachedFont(const QString &description, qreal scale)
+{
+    // Fonts are kept for the lifetime of the settings, QPlatformTheme::font() hands out
+    // pointers to them and the same few descriptions keep coming back anyway. Scaled
+    // variants and other rendering options are separate entries, fonts handed out
+    // are never changed.
+    QString cacheKey = description;
+    if (!qFuzzyCompare(scale, 1.0)) {
+        cacheKey += QStringLiteral(" @") + QString::number(scale);
+    }
+    if (m_fontHinting != QFont::PreferDefaultHinting || m_fontAntialiasing != QFont::PreferDefault) {
+        cacheKey += QStringLiteral(" #%1,%2").arg(int(m_fontHinting)).arg(int(m_fontAntialiasing));
+    }
+
+    QFont *&font = m_fontCache[cacheKey];
+    if (!font) {
+        font = new QFont(fontFromDescription(description));
+        font->setHintingPreference(m_fontHinting);
+        font->setStyleStrategy(m_fontAntialiasing);
+        if (!qFuzzyCompare(scale, 1.0)) {
+            if (font->pointSizeF() > 0) {
+                font->setPointSizeF(font->pointSizeF() * scale);
+            } else if (font->pixelSize() > 0) {
+                font->setPixelSize(qMax(1, qRound(font->pixelSize() * scale)));
+            }
+        }
+    }
+    return font;
+}
+
+QFont GnomeHintsSettings::fontFromDescription(const QString &description)
+{
+    QFont font;
+    PangoFontDescription *desc = pango_font_description_from_string(description.toUtf8().constData());
+
+    const QString family = QString::fromUtf8(pango_font_description_get_family(desc));
+    if (!family.isEmpty()) {
+        font.setFamily(family);
+    }
+
+    const gint size = pango_font_description_get_size(desc);
+    if (size > 0) {
+        if (pango_font_description_get_size_is_absolute(desc)) {
+            font.setPixelSize(qRound(static_cast<qreal>(size) / PANGO_SCALE));
+        } else {
+            font.setPointSizeF(static_cast<qreal>(size) / PANGO_SCALE);
+        }
+    }
+
+    font.setWeight(QPlatformFontDatabase::weightFromInteger(pango_font_description_get_weight(desc)));
+
+    const PangoStyle style = pango_font_description_get_style(desc);
+    if (style == PANGO_STYLE_ITALIC) {
+        font.setStyle(QFont::StyleItalic);
+    } else if (style == PANGO_STYLE_OBLIQUE) {
+        font.setStyle(QFont::StyleOblique);
     } else {
-        m_hints[QPlatformTheme::CursorFlashTime] = 1200;
+        font.setStyle(QFont::StyleNormal);
+    }
+
+    if (pango_font_description_get_variant(desc) == PANGO_VARIANT_SMALL_CAPS) {
+        font.setCapitalization(QFont::SmallCaps);
     }
 
-    gint doubleClickTime = 400;
-    g_object_get(gtk_settings_get_default(), "gtk-double-click-time", &doubleClickTime, NULL);
+    pango_font_description_free(desc);
+    return font;
+}
+
+void GnomeHintsSettings::loadPalette()
+{
+    PhaseTraceScope trace("GnomeHintsSettings::loadPalette");
+
+    m_gtkPalette = GtkPalette::forTheme(m_gtkTheme, m_gtkThemeDarkVariant);
+}
+
+void GnomeHintsSettings::loadStaticHints() {
+    PhaseTraceScope trace("GnomeHintsSettings::loadStaticHints");
+
+    loadAnimations();
+    loadCursorBlinkTime();
+    loadGtkHints();
+    loadIconTheme();
+
+    m_hints[QPlatformTheme::SystemIconFallbackThemeName] = "breeze";
+    // Not a single directory is looked at for the first frame, icon lookups skip the
+    // ones which don't exist. The data index drops them later.
+    m_hints[QPlatformTheme::IconThemeSearchPaths] = XdgDataIndex::iconThemeCandidatePaths();
+}
+
+void GnomeHintsSettings::loadGtkHints()
+{
+    PhaseTraceScope trace("GnomeHintsSettings::loadGtkHints");
+
+    const QVariantMap iniSettings = gtkIniSettings();
+
+    bool ok = false;
+    int doubleClickTime = getSettingsProperty<int>(DoubleClickTimeKey, &ok);
+    if (!ok) {
+        doubleClickTime = gtkIniSetting(iniSettings, QStringLiteral("gtk-double-click-time"), 400);
+    }
     qCDebug(QGnomePlatform) << "Double click time: " << doubleClickTime;
     m_hints[QPlatformTheme::MouseDoubleClickInterval] = doubleClickTime;
 
-    guint longPressTime = 500;
-    g_object_get(gtk_settings_get_default(), "gtk-long-press-time", &longPressTime, NULL);
+    const int longPressTime = gtkIniSetting(iniSettings, QStringLiteral("gtk-long-press-time"), 500);
     qCDebug(QGnomePlatform) << "Long press time: " << longPressTime;
     m_hints[QPlatformTheme::MousePressAndHoldInterval] = longPressTime;
 
-    gint doubleClickDistance = 5;
-    g_object_get(gtk_settings_get_default(), "gtk-double-click-distance", &doubleClickDistance, NULL);
+    const int doubleClickDistance = gtkIniSetting(iniSettings, QStringLiteral("gtk-double-click-distance"), 5);
     qCDebug(QGnomePlatform) << "Double click distance: " << doubleClickDistance;
     m_hints[QPlatformTheme::MouseDoubleClickDistance] = doubleClickDistance;
 
-    gint startDragDistance = 8;
-    g_object_get(gtk_settings_get_default(), "gtk-dnd-drag-threshold", &startDragDistance, NULL);
+    int startDragDistance = getSettingsProperty<int>(DragThresholdKey, &ok);
+    if (!ok) {
+        startDragDistance = gtkIniSetting(iniSettings, QStringLiteral("gtk-dnd-drag-threshold"), 8);
+    }
     qCDebug(QGnomePlatform) << "Dnd drag threshold: " << startDragDistance;
     m_hints[QPlatformTheme::StartDragDistance] = startDragDistance;
 
-    guint passwordMaskDelay = 0;
-    g_object_get(gtk_settings_get_default(), "gtk-entry-password-hint-timeout", &passwordMaskDelay, NULL);
+    const int passwordMaskDelay = gtkIniSetting(iniSettings, QStringLiteral("gtk-entry-password-hint-timeout"), 0);
     qCDebug(QGnomePlatform) << "Password hint timeout: " << passwordMaskDelay;
     m_hints[QPlatformTheme::PasswordMaskDelay] = passwordMaskDelay;
-
-    QString systemIconTheme = getSettingsProperty<QString>(QStringLiteral("icon-theme"));
-    if (!systemIconTheme.isEmpty()) {
-        qCDebug(QGnomePlatform) << "Icon theme: " << systemIconTheme;
-        m_hints[QPlatformTheme::SystemIconThemeName] = systemIconTheme;
-    } else {
-        m_hints[QPlatformTheme::SystemIconThemeName] = "Adwaita";
-    }
-    m_hints[QPlatformTheme::SystemIconFallbackThemeName] = "breeze";
-    m_hints[QPlatformTheme::IconThemeSearchPaths] = xdgIconThemePaths();
 }
 
-void GnomeHintsSettings::portalSettingChanged(const QString &group, const QString &key, const QDBusVariant &value)
+bool GnomeHintsSettings::loadSnapshot(const QByteArray &stamp)
 {
-    if (group == QStringLiteral("org.gnome.desktop.interface") || group == QStringLiteral("org.gnome.desktop.wm.preferences")) {
-        m_portalSettings[group][key] = value.variant();
-        gsettingPropertyChanged(nullptr, (gchar*)(key.toStdString().c_str()), this);
-    }
-}
+    PhaseTraceScope trace("GnomeHintsSettings::loadSnapshot");
 
-QStringList GnomeHintsSettings::xdgIconThemePaths() const
-{
-    QStringList paths;
+    QFile file(snapshotPath());
+    if (!file.open(QIODevice::ReadOnly) || file.size() <= 0) {
+        return false;
+    }
 
-    const QFileInfo homeIconDir(QDir::homePath() + QStringLiteral("/.icons"));
-    if (homeIconDir.isDir()) {
-        paths << homeIconDir.absoluteFilePath();
+    const uchar *data = file.map(0, file.size());
+    if (!data) {
+        return false;
     }
 
-    QString xdgDirString = QFile::decodeName(qgetenv("XDG_DATA_DIRS"));
+    const QByteArray bytes = QByteArray::fromRawData(reinterpret_cast<const char *>(data), file.size());
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_5_9);
 
-    if (xdgDirString.isEmpty()) {
-        xdgDirString = QStringLiteral("/usr/local/share:/usr/share");
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray snapshotStamp;
+    stream >> magic >> version;
+    if (magic != snapshotMagic || version != snapshotVersion) {
+        return false;
     }
 
-    for (const QString &xdgDir : xdgDirString.split(QLatin1Char(':'))) {
-        const QFileInfo xdgIconsDir(xdgDir + QStringLiteral("/icons"));
-        if (xdgIconsDir.isDir()) {
-            paths << xdgIconsDir.absoluteFilePath();
-        }
+    stream >> snapshotStamp;
+    if (stream.status() != QDataStream::Ok || snapshotStamp != stamp) {
+        qCDebug(QGnomePlatform) << "Settings snapshot is out of date";
+        return false;
     }
 
-    return paths;
-}
+    QString gtkTheme;
+    bool gtkThemeDarkVariant = false;
+    qint32 titlebarButtons = 0;
+    qint32 titlebarButtonPlacement = 0;
+    qint32 cursorBlinkTimeout = 0;
+    stream >> gtkTheme >> gtkThemeDarkVariant >> titlebarButtons >> titlebarButtonPlacement >> cursorBlinkTimeout;
+
+    qint32 hintCount = 0;
+    stream >> hintCount;
+    QHash<QPlatformTheme::ThemeHint, QVariant> hints;
+    for (qint32 i = 0; i < hintCount && stream.status() == QDataStream::Ok; ++i) {
+        qint32 hint = 0;
+        QVariant value;
+        stream >> hint >> value;
+        hints.insert(static_cast<QPlatformTheme::ThemeHint>(hint), value);
+    }
 
-QString GnomeHintsSettings::kvantumThemeForGtkTheme() const
-{
-    if (m_gtkTheme.isEmpty()) {
-        // No Gtk theme? Then can't match to Kvantum!
-        return QString();
+    qint32 valueCount = 0;
+    stream >> valueCount;
+    QVariant values[SettingKeyCount];
+    for (qint32 i = 0; i < valueCount && stream.status() == QDataStream::Ok; ++i) {
+        QVariant value;
+        stream >> value;
+        if (i < SettingKeyCount) {
+            values[i] = value;
+        }
     }
 
-    QString gtkName = m_gtkTheme;
-    QStringList dirs = QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation);
+    QHash<QString, QColor> colors;
+    stream >> colors;
+
+    qint32 fontCount = 0;
+    stream >> fontCount;
+    QList<QPair<QPlatformTheme::Font, QPair<QString, QFont>>> fonts;
+    for (qint32 i = 0; i < fontCount && stream.status() == QDataStream::Ok; ++i) {
+        qint32 type = 0;
+        QString description;
+        QFont font;
+        stream >> type >> description >> font;
+        fonts << qMakePair(static_cast<QPlatformTheme::Font>(type), qMakePair(description, font));
+    }
 
-    // Look for a matching KVantum config file in the theme's folder
-    for (const QString &dir : dirs) {
-        if (QFile::exists(QStringLiteral("%1/themes/%2/Kvantum/%3.kvconfig").arg(dir).arg(gtkName).arg(gtkName))) {
-            return gtkName;
-        }
+    if (stream.status() != QDataStream::Ok || valueCount != SettingKeyCount) {
+        qCWarning(QGnomePlatform) << "Settings snapshot is corrupted";
+        return false;
     }
 
-    // No config found in theme folder, look for a Kv<Theme> as shipped as part of Kvantum itself
-    // (Kvantum ships KvAdapta, KvAmbiance, KvArc, etc.
-    QStringList names { QStringLiteral("Kv") + gtkName };
+    m_gtkTheme = gtkTheme;
+    m_gtkThemeDarkVariant = gtkThemeDarkVariant;
+    m_titlebarButtons = TitlebarButtons(titlebarButtons);
+    m_titlebarButtonPlacement = static_cast<TitlebarButtonsPlacement>(titlebarButtonPlacement);
+    m_titlebarLoaded = true;
+    m_cursorBlinkTimeout = cursorBlinkTimeout;
+    m_gtkPalette = GtkPalette::fromColors(m_gtkTheme, m_gtkThemeDarkVariant, colors);
+
+    // The effects are computed from these, without reading the backend
+    for (int key = 0; key < SettingKeyCount; ++key) {
+        m_values[key] = values[key];
+    }
+    m_valuesLoaded = true;
 
-    // Convert Ark-Dark to ArcDark to look for KvArcDark
-    if (gtkName.indexOf("-") != -1) {
-        names.append("Kv" + gtkName.replace("-", ""));
+    for (auto it = hints.constBegin(); it != hints.constEnd(); ++it) {
+        if (uint(it.key()) < ThemeHintCount) {
+            m_hints[it.key()] = it.value();
+        }
     }
 
-    for (const QString &name : names) {
-        for (const QString &dir : dirs) {
-            if (QFile::exists(QStringLiteral("%1/Kvantum/%2/%3.kvconfig").arg(dir).arg(name).arg(name))) {
-                return name;
-            }
+    m_fonts.clear();
+    for (const auto &font : fonts) {
+        QFont *&cached = m_fontCache[font.second.first];
+        if (!cached) {
+            cached = new QFont(font.second.second);
         }
+        m_fonts[font.first] = cached;
     }
 
-    return QString();
+    qCDebug(QGnomePlatform) << "Settings loaded from snapshot, theme name: " << m_gtkTheme;
+    return true;
 }
 
-void GnomeHintsSettings::configureKvantum(const QString &theme) const
+void GnomeHintsSettings::saveSnapshot(const QByteArray &stamp) const
 {
-    QSettings config(QDir::homePath() + "/.config/Kvantum/kvantum.kvconfig", QSettings::NativeFormat);
-    if (!config.contains("theme") || config.value("theme").toString() != theme) {
-        config.setValue("theme", theme);
+    PhaseTraceScope trace("GnomeHintsSettings::saveSnapshot");
+
+    const QString path = snapshotPath();
+    if (path.isEmpty()) {
+        return;
+    }
+
+    // Written to a temporary file and renamed, concurrent readers see either version complete
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_9);
+
+    stream << snapshotMagic << snapshotVersion << stamp;
+    stream << m_gtkTheme << m_gtkThemeDarkVariant << qint32(m_titlebarButtons) << qint32(m_titlebarButtonPlacement) << qint32(m_cursorBlinkTimeout);
+
+    stream << qint32(sizeof(snapshotHints) / sizeof(snapshotHints[0]));
+    for (QPlatformTheme::ThemeHint hint : snapshotHints) {
+        stream << qint32(hint) << m_hints[hint];
+    }
+
+    stream << qint32(SettingKeyCount);
+    for (const QVariant &value : m_values) {
+        stream << value;
+    }
+
+    stream << m_gtkPalette->colors();
+
+    stream << qint32(m_fonts.count());
+    for (auto it = m_fonts.constBegin(); it != m_fonts.constEnd(); ++it) {
+        stream << qint32(it.key()) << m_fontCache.key(it.value()) << *it.value();
+    }
+
+    if (!file.commit()) {
+        qCDebug(QGnomePlatform) << "Failed to write settings snapshot to " << path;
     }
 }
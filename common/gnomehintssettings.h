@@ -20,23 +20,26 @@
 #ifndef GNOME_HINTS_SETTINGS_H
 #define GNOME_HINTS_SETTINGS_H
 
-#include <QDBusVariant>
 #include <QFont>
 #include <QFlags>
 #include <QObject>
+#include <QPointer>
+#include <QTimer>
 #include <QVariant>
+#include <QVector>
 
-#include <memory>
+#include "atomicsnapshot.h"
+#include "gtkpalette.h"
+#include "xdgdataindex.h"
 
-#undef signals
-#include <gio/gio.h>
-#include <gtk-3.0/gtk/gtk.h>
-#include <gtk-3.0/gtk/gtksettings.h>
-#define signals Q_SIGNALS
+#include <functional>
+#include <memory>
 
 #include <qpa/qplatformtheme.h>
 
-class QPalette;
+class CursorBlinkTracker;
+class PowerProfileMonitor;
+class SettingsBackend;
 
 class GnomeHintsSettings : public QObject
 {
@@ -54,150 +57,248 @@ public:
     };
     Q_DECLARE_FLAGS(TitlebarButtons, TitlebarButton);
 
-    explicit GnomeHintsSettings();
-    virtual ~GnomeHintsSettings();
+    enum Change {
+        ThemeChange = 0x01,
+        IconThemeChange = 0x02,
+        CursorBlinkChange = 0x04,
+        CursorSizeChange = 0x08,
+        FontChange = 0x10,
+        TitlebarChange = 0x20,
+        GtkHintsChange = 0x40,
+        DataDirsChange = 0x80,
+        AnimationsChange = 0x100
+    };
+    Q_DECLARE_FLAGS(Changes, Change);
+    Q_FLAG(Changes)
+
+    // Size of the hint tables indexed by QPlatformTheme::ThemeHint, hints added
+    // by newer Qt versions past it are left to QPlatformTheme
+    enum { ThemeHintCount = 64 };
+
+    // Every setting we read, each desktop backend maps them to its own configuration
+    enum SettingKey {
+        GtkThemeKey = 0,
+        IconThemeKey,
+        CursorBlinkKey,
+        CursorBlinkTimeKey,
+        CursorBlinkTimeoutKey,
+        CursorSizeKey,
+        FontNameKey,
+        MonospaceFontNameKey,
+        TextScalingFactorKey,
+        FontAntialiasingKey,
+        FontHintingKey,
+        FontRgbaOrderKey,
+        EnableAnimationsKey,
+        TitlebarFontKey,
+        ButtonLayoutKey,
+        DoubleClickTimeKey,
+        DragThresholdKey,
+        SettingKeyCount
+    };
+
+    static const char *settingKeyName(SettingKey key);
+    static SettingKey settingKeyFromName(const char *name);
+
+    typedef std::function<void(const QVariant &oldValue, const QVariant &newValue)> SettingCallback;
+
+    // Calls back with the previous and the new value of the setting whenever it
+    // changes, once the change has been applied. Holds until unsubscribe() with the
+    // returned id or until the context object is destroyed.
+    int subscribe(SettingKey key, const QObject *context, const SettingCallback &callback);
+    void unsubscribe(int id);
+
+    template <typename T>
+    int subscribe(SettingKey key, const QObject *context, const std::function<void(const T &oldValue, const T &newValue)> &callback)
+    {
+        return subscribe(key, context, SettingCallback([callback] (const QVariant &oldValue, const QVariant &newValue) {
+            callback(oldValue.value<T>(), newValue.value<T>());
+        }));
+    }
+
+    // The settings are shared by the platform theme and every window decoration
+    // in the process. Each acquire() must be balanced by a release().
+    static GnomeHintsSettings *acquire();
+    static void release(GnomeHintsSettings *settings);
+
+    // Immutable view of the resolved settings. A change builds a new one and swaps it
+    // in, so readers on any thread get a consistent set of values without locking
+    // against the GUI thread. The snapshot itself is only valid until the change after
+    // the next one, see AtomicSnapshot. Fonts and palettes it points to live as long
+    // as the settings, pointers handed out stay valid after the snapshot is replaced.
+    struct Snapshot {
+        quint64 generation = 0;
+        QVariant hints[ThemeHintCount];
+        QHash<QPlatformTheme::Font, QFont *> fonts;
+        QString gtkTheme;
+        bool gtkThemeDarkVariant = false;
+        TitlebarButtons titlebarButtons = TitlebarButton::CloseButton;
+        TitlebarButtonsPlacement titlebarButtonPlacement = TitlebarButtonsPlacement::RightPlacement;
+        const GtkPalette *gtkPalette = nullptr;
+        bool lowBandwidth = false;
+    };
+
+    inline const Snapshot *snapshot() const
+    {
+        return m_snapshot.load();
+    }
 
-    inline QFont * font(QPlatformTheme::Font type) const
+    // Changes whenever a new snapshot is published, lets users of the settings
+    // find out cheaply whether what they derived from them is out of date
+    inline quint64 generation() const
     {
-        if (m_fonts.contains(type)) {
-            return m_fonts[type];
-        } else if (m_fonts.contains(QPlatformTheme::SystemFont)) {
-            return m_fonts[QPlatformTheme::SystemFont];
-        } else {
-            // GTK default font
-            return new QFont(QLatin1String("Sans"), 10);
+        return snapshot()->generation;
+    }
+
+    inline const QFont *font(QPlatformTheme::Font type) const
+    {
+        const Snapshot *current = snapshot();
+        QFont *font = current->fonts.value(type);
+        if (!font) {
+            font = current->fonts.value(QPlatformTheme::SystemFont);
         }
+
+        // GTK default font otherwise
+        return font ? font : &m_defaultFont;
     }
 
     inline bool gtkThemeDarkVariant() const
     {
-        return m_gtkThemeDarkVariant;
+        return snapshot()->gtkThemeDarkVariant;
     }
 
     inline QString gtkTheme() const
     {
-        return QString(m_gtkTheme);
+        return snapshot()->gtkTheme;
     }
 
     inline QVariant hint(QPlatformTheme::ThemeHint hint) const
     {
-        return m_hints[hint];
+        return uint(hint) < ThemeHintCount ? snapshot()->hints[hint] : QVariant();
     }
 
-    inline QPalette *palette() const
+    inline const QPalette *palette() const
     {
-        return m_palette;
+        const GtkPalette *palette = gtkPalette();
+        return palette ? &palette->palette() : nullptr;
+    }
+
+    inline const GtkPalette *gtkPalette() const
+    {
+        return snapshot()->gtkPalette;
+    }
+
+    // Set for sessions shown over VNC, RDP or SPICE, where every repainted pixel has to
+    // go over the network. Effects are off then and decorations draw flat.
+    inline bool isLowBandwidth() const
+    {
+        return snapshot()->lowBandwidth;
     }
 
     inline TitlebarButtons titlebarButtons() const
     {
-        return m_titlebarButtons;
+        return snapshot()->titlebarButtons;
     }
 
     inline TitlebarButtonsPlacement titlebarButtonPlacement() const
     {
-        return m_titlebarButtonPlacement;
+        return snapshot()->titlebarButtonPlacement;
     }
 
+Q_SIGNALS:
+    // Emitted once the changes collected from the backends have been applied
+    void settingsChanged(GnomeHintsSettings::Changes changes);
+
 public Q_SLOTS:
-    void cursorBlinkTimeChanged();
     void cursorSizeChanged();
-    void fontChanged();
-    void iconsChanged();
-    void themeChanged();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
 
 private Q_SLOTS:
+    void applyPendingChanges();
+    void loadDeferred();
+    void backendValueChanged(GnomeHintsSettings::SettingKey key, const QVariant &value);
+    void loadCursorBlinkTime();
     void loadFonts();
+    void loadFontRendering();
+    void loadAnimations();
+    void loadIconTheme();
     void loadTheme();
     void loadTitlebar();
     void loadPalette();
     void loadStaticHints();
-    void portalSettingChanged(const QString &group, const QString &key, const QDBusVariant &value);
-
-protected:
-    static void gsettingPropertyChanged(GSettings *settings, gchar *key, GnomeHintsSettings *gnomeHintsSettings);
+    void loadGtkHints();
 
 private:
-    template <typename T> T getSettingsProperty(GSettings *settings, const QString &property, bool *ok = nullptr) {
-        Q_UNUSED(settings); Q_UNUSED(property); Q_UNUSED(ok);
-        return {};
-    }
-    template <typename T>
-    T getSettingsProperty(const QString &property, bool *ok = nullptr) {
-        GSettings *settings = m_settings;
-
-        // In case of Cinnamon session, we most probably want to return the value from here if possible
-        if (m_cinnamonSettings) {
-            GSettingsSchema *schema;
-            g_object_get(G_OBJECT(m_cinnamonSettings), "settings-schema", &schema, NULL);
-
-            if (schema) {
-                if (g_settings_schema_has_key(schema, property.toStdString().c_str())) {
-                    settings = m_cinnamonSettings;
-                }
-            }
-        }
-
-        // Use org.gnome.desktop.wm.preferences if the property is there, otherwise it would bail on
-        // non-existent property
-        GSettingsSchema *schema;
-        g_object_get(G_OBJECT(m_gnomeDesktopSettings), "settings-schema", &schema, NULL);
-
-        if (schema) {
-            if (g_settings_schema_has_key(schema, property.toStdString().c_str())) {
-                settings = m_gnomeDesktopSettings;
-            }
-        }
-
-        if (m_usePortal) {
-            QVariant value = m_portalSettings.value(QStringLiteral("org.gnome.desktop.interface")).value(property);
-            if (!value.isNull() && value.canConvert<T>())
-                return value.value<T>();
-            value = m_portalSettings.value(QStringLiteral("org.gnome.desktop.wm.preferences")).value(property);
-            if (!value.isNull() && value.canConvert<T>())
-                return value.value<T>();
-        }
+    explicit GnomeHintsSettings();
+    virtual ~GnomeHintsSettings();
 
-        return getSettingsProperty<T>(settings, property, ok);
+    template <typename T>
+    T getSettingsProperty(SettingKey key, bool *ok = nullptr) {
+        const QVariant &value = settingValue(key);
+        if (ok)
+            *ok = value.isValid() && value.canConvert<T>();
+        return value.value<T>();
     }
-    QStringList xdgIconThemePaths() const;
-    QString kvantumThemeForGtkTheme() const;
-    void configureKvantum(const QString &theme) const;
-
-    bool m_usePortal;
+    const QVariant &settingValue(SettingKey key);
+    void notifySubscribers(quint32 keys);
+    static Changes changesForKey(SettingKey key);
+    void settingChanged(SettingKey key);
+    void queueChanges(Changes changes);
+    void updateApplication(Changes changes);
+    void publishSnapshot();
+    QFont *cachedFont(const QString &description, qreal scale = 1.0);
+    static QFont fontFromDescription(const QString &description);
+    bool loadSnapshot(const QByteArray &stamp);
+    void saveSnapshot(const QByteArray &stamp) const;
+    void syncKvantumConfig();
+
+    int m_refCount = 0;
+    Changes m_pendingChanges;
+    quint32 m_pendingKeys = 0;
+    QTimer m_changeTimer;
+    QTimer m_deferredTimer;
+    bool m_deferredLoaded = false;
+    // Set when the snapshot is to be written once the deferred settings are loaded too
+    QByteArray m_snapshotStamp;
+    XdgDataIndex m_dataIndex;
+    SettingsBackend *m_backend;
+    // Read from the backend in one go the first time any of them is needed
+    QVariant m_values[SettingKeyCount];
+    bool m_valuesLoaded = false;
+    PowerProfileMonitor *m_powerProfiles = nullptr;
+    CursorBlinkTracker *m_cursorBlinkTracker;
+    // Milliseconds without input after which the cursor stops blinking, 0 for never
+    int m_cursorBlinkTimeout = 0;
+    bool m_lowBandwidth;
     bool m_gtkThemeDarkVariant = false;
     TitlebarButtons m_titlebarButtons = TitlebarButton::CloseButton;
     TitlebarButtonsPlacement m_titlebarButtonPlacement = TitlebarButtonsPlacement::RightPlacement;
     QString m_gtkTheme = nullptr;
-    QPalette *m_palette = nullptr;
-    GSettings *m_cinnamonSettings = nullptr;
-    GSettings *m_gnomeDesktopSettings = nullptr;
-    GSettings *m_settings = nullptr;
+    QString m_kvantumTheme;
+    bool m_titlebarLoaded = false;
+    const GtkPalette *m_gtkPalette = nullptr;
+
+    struct Subscription {
+        int id;
+        QPointer<const QObject> context;
+        SettingCallback callback;
+        QMetaObject::Connection contextConnection;
+    };
+    QVector<Subscription> m_subscriptions[SettingKeyCount];
+    QVariant m_subscribedValues[SettingKeyCount];
+    int m_nextSubscriptionId = 1;
     QHash<QPlatformTheme::Font, QFont*> m_fonts;
-    QHash<QPlatformTheme::ThemeHint, QVariant> m_hints;
-    QMap<QString, QVariantMap> m_portalSettings;
+    QHash<QString, QFont*> m_fontCache;
+    QFont::HintingPreference m_fontHinting = QFont::PreferDefaultHinting;
+    QFont::StyleStrategy m_fontAntialiasing = QFont::PreferDefault;
+    const QFont m_defaultFont = QFont(QLatin1String("Sans"), 10);
+    AtomicSnapshot<Snapshot> m_snapshot;
+    QVariant m_hints[ThemeHintCount];
 };
 
-template <> inline int GnomeHintsSettings::getSettingsProperty(GSettings *settings, const QString &property, bool *ok) {
-    if (ok)
-        *ok = true;
-    return g_settings_get_int(settings, property.toStdString().c_str());
-}
-
-template <> inline QString GnomeHintsSettings::getSettingsProperty(GSettings *settings, const QString &property, bool *ok) {
-    // be exception and resources safe
-    std::unique_ptr<gchar, void(*)(gpointer)> raw {g_settings_get_string(settings, property.toStdString().c_str()), g_free};
-    if (ok)
-        *ok = !!raw;
-    return QString{raw.get()};
-}
-
-template <> inline qreal GnomeHintsSettings::getSettingsProperty(GSettings *settings, const QString &property, bool *ok) {
-    if (ok)
-        *ok = true;
-    return g_settings_get_double(settings, property.toStdString().c_str());
-}
-
 Q_DECLARE_OPERATORS_FOR_FLAGS(GnomeHintsSettings::TitlebarButtons)
+Q_DECLARE_OPERATORS_FOR_FLAGS(GnomeHintsSettings::Changes)
 
 #endif // GNOME_HINTS_SETTINGS_H
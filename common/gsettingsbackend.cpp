@@ -0,0 +1,303 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gsettingsbackend.h"
+#include "dconfreader.h"
+#include "gsettingsworker.h"
+#include "phasetrace.h"
+#include "runtimestats.h"
+
+#include <QLoggingCategory>
+#include <QVector>
+
+Q_DECLARE_LOGGING_CATEGORY(QGnomePlatform)
+
+GSettingsBackend *GSettingsBackend::gnome(QObject *parent)
+{
+    static const KeyMapping keys[] = {
+        { GnomeHintsSettings::GtkThemeKey, "org.gnome.desktop.interface", "gtk-theme" },
+        { GnomeHintsSettings::IconThemeKey, "org.gnome.desktop.interface", "icon-theme" },
+        { GnomeHintsSettings::CursorBlinkKey, "org.gnome.desktop.interface", "cursor-blink" },
+        { GnomeHintsSettings::CursorBlinkTimeKey, "org.gnome.desktop.interface", "cursor-blink-time" },
+        { GnomeHintsSettings::CursorBlinkTimeoutKey, "org.gnome.desktop.interface", "cursor-blink-timeout" },
+        { GnomeHintsSettings::CursorSizeKey, "org.gnome.desktop.interface", "cursor-size" },
+        { GnomeHintsSettings::FontNameKey, "org.gnome.desktop.interface", "font-name" },
+        { GnomeHintsSettings::MonospaceFontNameKey, "org.gnome.desktop.interface", "monospace-font-name" },
+        { GnomeHintsSettings::TextScalingFactorKey, "org.gnome.desktop.interface", "text-scaling-factor" },
+        // Moved to the interface settings in GNOME 40, the settings daemon had them before
+        { GnomeHintsSettings::FontAntialiasingKey, "org.gnome.desktop.interface", "font-antialiasing" },
+        { GnomeHintsSettings::FontAntialiasingKey, "org.gnome.settings-daemon.plugins.xsettings", "antialiasing" },
+        { GnomeHintsSettings::FontHintingKey, "org.gnome.desktop.interface", "font-hinting" },
+        { GnomeHintsSettings::FontHintingKey, "org.gnome.settings-daemon.plugins.xsettings", "hinting" },
+        { GnomeHintsSettings::FontRgbaOrderKey, "org.gnome.desktop.interface", "font-rgba-order" },
+        { GnomeHintsSettings::FontRgbaOrderKey, "org.gnome.settings-daemon.plugins.xsettings", "rgba-order" },
+        { GnomeHintsSettings::EnableAnimationsKey, "org.gnome.desktop.interface", "enable-animations" },
+        { GnomeHintsSettings::TitlebarFontKey, "org.gnome.desktop.wm.preferences", "titlebar-font" },
+        { GnomeHintsSettings::ButtonLayoutKey, "org.gnome.desktop.wm.preferences", "button-layout" },
+        // Which GTK gets from here through XSettings or directly on Wayland
+        { GnomeHintsSettings::DoubleClickTimeKey, "org.gnome.desktop.peripherals.mouse", "double-click" },
+        { GnomeHintsSettings::DragThresholdKey, "org.gnome.desktop.peripherals.mouse", "drag-threshold" }
+    };
+
+    return new GSettingsBackend("gnome", keys, sizeof(keys) / sizeof(keys[0]), parent);
+}
+
+GSettingsBackend *GSettingsBackend::cinnamon(QObject *parent)
+{
+    // Cinnamon has its own copy of the interface settings, the rest is shared with GNOME
+    static const KeyMapping keys[] = {
+        { GnomeHintsSettings::GtkThemeKey, "org.cinnamon.desktop.interface", "gtk-theme" },
+        { GnomeHintsSettings::IconThemeKey, "org.cinnamon.desktop.interface", "icon-theme" },
+        { GnomeHintsSettings::CursorBlinkKey, "org.cinnamon.desktop.interface", "cursor-blink" },
+        { GnomeHintsSettings::CursorBlinkKey, "org.gnome.desktop.interface", "cursor-blink" },
+        { GnomeHintsSettings::CursorBlinkTimeKey, "org.cinnamon.desktop.interface", "cursor-blink-time" },
+        { GnomeHintsSettings::CursorBlinkTimeoutKey, "org.cinnamon.desktop.interface", "cursor-blink-timeout" },
+        { GnomeHintsSettings::CursorBlinkTimeoutKey, "org.gnome.desktop.interface", "cursor-blink-timeout" },
+        { GnomeHintsSettings::CursorSizeKey, "org.cinnamon.desktop.interface", "cursor-size" },
+        { GnomeHintsSettings::FontNameKey, "org.cinnamon.desktop.interface", "font-name" },
+        { GnomeHintsSettings::MonospaceFontNameKey, "org.gnome.desktop.interface", "monospace-font-name" },
+        { GnomeHintsSettings::TextScalingFactorKey, "org.cinnamon.desktop.interface", "text-scaling-factor" },
+        { GnomeHintsSettings::FontAntialiasingKey, "org.cinnamon.settings-daemon.plugins.xsettings", "antialiasing" },
+        { GnomeHintsSettings::FontHintingKey, "org.cinnamon.settings-daemon.plugins.xsettings", "hinting" },
+        { GnomeHintsSettings::FontRgbaOrderKey, "org.cinnamon.settings-daemon.plugins.xsettings", "rgba-order" },
+        { GnomeHintsSettings::EnableAnimationsKey, "org.cinnamon.desktop.interface", "enable-animations" },
+        { GnomeHintsSettings::EnableAnimationsKey, "org.gnome.desktop.interface", "enable-animations" },
+        { GnomeHintsSettings::TitlebarFontKey, "org.gnome.desktop.wm.preferences", "titlebar-font" },
+        { GnomeHintsSettings::ButtonLayoutKey, "org.gnome.desktop.wm.preferences", "button-layout" },
+        { GnomeHintsSettings::DoubleClickTimeKey, "org.gnome.desktop.peripherals.mouse", "double-click" },
+        { GnomeHintsSettings::DragThresholdKey, "org.gnome.desktop.peripherals.mouse", "drag-threshold" }
+    };
+
+    return new GSettingsBackend("cinnamon", keys, sizeof(keys) / sizeof(keys[0]), parent);
+}
+
+GSettingsBackend *GSettingsBackend::mate(QObject *parent)
+{
+    static const KeyMapping keys[] = {
+        { GnomeHintsSettings::GtkThemeKey, "org.mate.interface", "gtk-theme" },
+        { GnomeHintsSettings::IconThemeKey, "org.mate.interface", "icon-theme" },
+        { GnomeHintsSettings::CursorBlinkKey, "org.mate.interface", "cursor-blink" },
+        { GnomeHintsSettings::CursorBlinkTimeKey, "org.mate.interface", "cursor-blink-time" },
+        { GnomeHintsSettings::CursorBlinkTimeoutKey, "org.mate.interface", "cursor-blink-timeout" },
+        { GnomeHintsSettings::CursorSizeKey, "org.mate.peripherals-mouse", "cursor-size" },
+        { GnomeHintsSettings::FontNameKey, "org.mate.interface", "font-name" },
+        { GnomeHintsSettings::MonospaceFontNameKey, "org.mate.interface", "monospace-font-name" },
+        { GnomeHintsSettings::FontAntialiasingKey, "org.mate.font-rendering", "antialiasing" },
+        { GnomeHintsSettings::FontHintingKey, "org.mate.font-rendering", "hinting" },
+        { GnomeHintsSettings::FontRgbaOrderKey, "org.mate.font-rendering", "rgba-order" },
+        { GnomeHintsSettings::EnableAnimationsKey, "org.mate.interface", "enable-animations" },
+        { GnomeHintsSettings::TitlebarFontKey, "org.mate.Marco.general", "titlebar-font" },
+        { GnomeHintsSettings::ButtonLayoutKey, "org.mate.Marco.general", "button-layout" },
+        { GnomeHintsSettings::DoubleClickTimeKey, "org.mate.peripherals-mouse", "double-click" },
+        { GnomeHintsSettings::DragThresholdKey, "org.mate.peripherals-mouse", "drag-threshold" }
+    };
+
+    return new GSettingsBackend("mate", keys, sizeof(keys) / sizeof(keys[0]), parent);
+}
+
+GSettingsBackend::GSettingsBackend(const char *name, const KeyMapping *keys, int keyCount, QObject *parent)
+    : SettingsBackend(parent)
+    , m_name(name)
+{
+    // Keys whose schema isn't installed are dropped here, once, and stay invalid. A key
+    // may be listed more than once, the first installed location wins.
+    GSettingsSchemaSource *source = g_settings_schema_source_get_default();
+    for (int i = 0; source && i < keyCount; ++i) {
+        const KeyMapping &mapping = keys[i];
+        if (m_keys[mapping.key].schema) {
+            continue;
+        }
+
+        GSettingsSchema *schema = g_settings_schema_source_lookup(source, mapping.schemaId, TRUE);
+        if (!schema) {
+            qCDebug(QGnomePlatform) << "Schema " << mapping.schemaId << " is not installed";
+            continue;
+        }
+
+        if (g_settings_schema_has_key(schema, mapping.name)) {
+            m_keys[mapping.key].schema = schema;
+            m_keys[mapping.key].name = QByteArray(mapping.name);
+        } else {
+            g_settings_schema_unref(schema);
+        }
+    }
+}
+
+GSettingsBackend::~GSettingsBackend()
+{
+    delete m_worker;
+
+    for (GSettings *settings : qAsConst(m_settings)) {
+        g_object_unref(settings);
+    }
+
+    for (const Key &key : m_keys) {
+        if (key.schema) {
+            g_settings_schema_unref(key.schema);
+        }
+    }
+    delete m_dconf;
+}
+
+const char *GSettingsBackend::name() const
+{
+    return m_name;
+}
+
+void GSettingsBackend::readAll(QVariant *values)
+{
+    PhaseTraceScope trace("GSettingsBackend::readAll");
+
+    // Optionally read the values straight from the dconf databases. Otherwise, and
+    // once changes are watched, GSettings and its dconf engine are set up.
+    if (!m_worker && !m_dconf && qEnvironmentVariableIsSet("QGNOMEPLATFORM_DCONF_DIRECT")) {
+        m_dconf = new DConfReader(DConfReader::profileDatabases());
+        if (m_dconf->isEmpty()) {
+            delete m_dconf;
+            m_dconf = nullptr;
+        }
+    }
+
+    if (!m_dconf) {
+        createSettings();
+    }
+
+    for (int key = 0; key < GnomeHintsSettings::SettingKeyCount; ++key) {
+        if (!m_keys[key].schema) {
+            continue;
+        }
+
+        m_values[key] = m_dconf ? directValue(m_keys[key]) : settingsValue(m_keys[key]);
+        values[key] = m_values[key];
+    }
+}
+
+void GSettingsBackend::watch(const QVariant *values)
+{
+    if (m_worker) {
+        return;
+    }
+
+    createSettings();
+
+    QVector<GSettingsWorker::WatchedKey> watchedKeys;
+    for (int key = 0; key < GnomeHintsSettings::SettingKeyCount; ++key) {
+        const Key &settingKey = m_keys[key];
+        if (settingKey.settings) {
+            watchedKeys.append({ QByteArray(g_settings_schema_get_id(settingKey.schema)), settingKey.name, key });
+        }
+    }
+
+    // Watch for changes in a thread of its own, so it works with any event dispatcher
+    m_worker = new GSettingsWorker(watchedKeys, this);
+    connect(m_worker, &GSettingsWorker::settingChanged, this, &GSettingsBackend::workerSettingChanged);
+    m_worker->start();
+
+    // Pick up whatever changed since the values were read, by this process or by the
+    // one which wrote the snapshot. The worker's first reports are compared to these.
+    for (int key = 0; key < GnomeHintsSettings::SettingKeyCount; ++key) {
+        if (!m_keys[key].settings) {
+            continue;
+        }
+
+        const QVariant value = settingsValue(m_keys[key]);
+        m_values[key] = value;
+        if (value != values[key]) {
+            Q_EMIT valueChanged(static_cast<SettingKey>(key), value);
+        }
+    }
+
+    delete m_dconf;
+    m_dconf = nullptr;
+}
+
+void GSettingsBackend::createSettings()
+{
+    for (int key = 0; key < GnomeHintsSettings::SettingKeyCount; ++key) {
+        Key &settingKey = m_keys[key];
+        if (!settingKey.schema || settingKey.settings) {
+            continue;
+        }
+
+        const QByteArray schemaId(g_settings_schema_get_id(settingKey.schema));
+        GSettings *&settings = m_settings[schemaId];
+        if (!settings) {
+            PhaseTraceScope trace("g_settings_new");
+            settings = g_settings_new_full(settingKey.schema, nullptr, nullptr);
+        }
+        settingKey.settings = settings;
+    }
+}
+
+void GSettingsBackend::workerSettingChanged(int key, const QVariant &value, bool initial)
+{
+    if (key < 0 || key >= GnomeHintsSettings::SettingKeyCount) {
+        return;
+    }
+
+    // The first values only tell whether anything changed before the watch was set up
+    if (initial) {
+        const QVariant current = m_values[key].isValid() ? m_values[key] : settingsValue(m_keys[key]);
+        if (value == current) {
+            m_values[key] = value;
+            return;
+        }
+    }
+
+    m_values[key] = value;
+    Q_EMIT valueChanged(static_cast<SettingKey>(key), value);
+}
+
+QVariant GSettingsBackend::settingsValue(const Key &key) const
+{
+    if (!key.settings) {
+        return directValue(key);
+    }
+
+    RuntimeStats::count(RuntimeStats::GSettingsReads);
+    GVariant *value = g_settings_get_value(key.settings, key.name.constData());
+    const QVariant result = DConfReader::toVariant(value);
+    if (value) {
+        g_variant_unref(value);
+    }
+    return result;
+}
+
+QVariant GSettingsBackend::directValue(const Key &key) const
+{
+    if (!m_dconf || !key.schema) {
+        return QVariant();
+    }
+
+    RuntimeStats::count(RuntimeStats::DConfReads);
+    const QByteArray path = QByteArray(g_settings_schema_get_path(key.schema)) + key.name;
+    QVariant value = m_dconf->value(path);
+    if (value.isValid()) {
+        return value;
+    }
+
+    // Not set by the user nor the system administrator, use the schema default
+    GSettingsSchemaKey *schemaKey = g_settings_schema_get_key(key.schema, key.name.constData());
+    GVariant *defaultValue = g_settings_schema_key_get_default_value(schemaKey);
+    value = DConfReader::toVariant(defaultValue);
+    g_variant_unref(defaultValue);
+    g_settings_schema_key_unref(schemaKey);
+
+    return value;
+}
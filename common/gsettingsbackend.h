@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef GSETTINGS_BACKEND_H
+#define GSETTINGS_BACKEND_H
+
+#include "settingsbackend.h"
+
+#include <QByteArray>
+#include <QHash>
+
+#undef signals
+#include <gio/gio.h>
+#define signals Q_SIGNALS
+
+class DConfReader;
+class GSettingsWorker;
+
+// Settings of the GNOME based desktops, which only differ in the schemas holding
+// the keys. Works with whatever GSettings backend GSETTINGS_BACKEND selects, the
+// memory one included.
+class GSettingsBackend : public SettingsBackend
+{
+    Q_OBJECT
+public:
+    static GSettingsBackend *gnome(QObject *parent = nullptr);
+    static GSettingsBackend *cinnamon(QObject *parent = nullptr);
+    static GSettingsBackend *mate(QObject *parent = nullptr);
+
+    ~GSettingsBackend();
+
+    const char *name() const override;
+    void readAll(QVariant *values) override;
+    void watch(const QVariant *values) override;
+
+private Q_SLOTS:
+    void workerSettingChanged(int key, const QVariant &value, bool initial);
+
+private:
+    struct KeyMapping {
+        SettingKey key;
+        const char *schemaId;
+        const char *name;
+    };
+
+    struct Key {
+        GSettingsSchema *schema = nullptr;
+        GSettings *settings = nullptr;
+        QByteArray name;
+    };
+
+    GSettingsBackend(const char *name, const KeyMapping *keys, int keyCount, QObject *parent);
+
+    void createSettings();
+
+    QVariant settingsValue(const Key &key) const;
+    QVariant directValue(const Key &key) const;
+
+    const char *m_name;
+    Key m_keys[GnomeHintsSettings::SettingKeyCount];
+    QHash<QByteArray, GSettings *> m_settings;
+    // Last values handed out, to tell which ones the worker reports as changed
+    QVariant m_values[GnomeHintsSettings::SettingKeyCount];
+    DConfReader *m_dconf = nullptr;
+    GSettingsWorker *m_worker = nullptr;
+};
+
+#endif // GSETTINGS_BACKEND_H
@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gsettingsworker.h"
+#include "dconfreader.h"
+#include "phasetrace.h"
+#include "runtimestats.h"
+
+GSettingsWorker::GSettingsWorker(const QVector<WatchedKey> &keys, QObject *parent)
+    : QThread(parent)
+    , m_keys(keys)
+    , m_context(g_main_context_new())
+    , m_loop(g_main_loop_new(m_context, FALSE))
+{
+    setObjectName(QStringLiteral("QGnomePlatform GSettings"));
+
+    for (const WatchedKey &key : m_keys) {
+        m_keyIds.insert(key.name, key.key);
+    }
+}
+
+GSettingsWorker::~GSettingsWorker()
+{
+    stop();
+    wait();
+
+    g_main_loop_unref(m_loop);
+    g_main_context_unref(m_context);
+}
+
+void GSettingsWorker::stop()
+{
+    // Queued rather than invoked, so it also stops a loop which hasn't started yet
+    GSource *source = g_idle_source_new();
+    g_source_set_callback(source, quit, m_loop, nullptr);
+    g_source_attach(source, m_context);
+    g_source_unref(source);
+}
+
+void GSettingsWorker::run()
+{
+    g_main_context_push_thread_default(m_context);
+
+    // Created here, so their signals are emitted in our context
+    QHash<QByteArray, GSettings *> settings;
+    for (const WatchedKey &key : m_keys) {
+        GSettings *&schemaSettings = settings[key.schemaId];
+        if (!schemaSettings) {
+            PhaseTraceScope trace("g_settings_new");
+            schemaSettings = g_settings_new(key.schemaId.constData());
+        }
+
+        const QByteArray signal = QByteArrayLiteral("changed::") + key.name;
+        g_signal_connect(schemaSettings, signal.constData(), G_CALLBACK(changed), this);
+
+        // GSettings only notifies about keys which have been read
+        reportValue(schemaSettings, key.name.constData(), true);
+    }
+
+    g_main_loop_run(m_loop);
+
+    for (GSettings *schemaSettings : settings) {
+        g_signal_handlers_disconnect_by_data(schemaSettings, this);
+        g_object_unref(schemaSettings);
+    }
+
+    g_main_context_pop_thread_default(m_context);
+}
+
+void GSettingsWorker::changed(GSettings *settings, gchar *name, gpointer data)
+{
+    static_cast<GSettingsWorker *>(data)->reportValue(settings, name, false);
+}
+
+gboolean GSettingsWorker::quit(gpointer data)
+{
+    g_main_loop_quit(static_cast<GMainLoop *>(data));
+    return G_SOURCE_REMOVE;
+}
+
+void GSettingsWorker::reportValue(GSettings *settings, const char *name, bool initial)
+{
+    const int key = m_keyIds.value(QByteArray::fromRawData(name, qstrlen(name)), -1);
+    if (key == -1) {
+        return;
+    }
+
+    RuntimeStats::count(RuntimeStats::GSettingsReads);
+    GVariant *value = g_settings_get_value(settings, name);
+    const QVariant result = DConfReader::toVariant(value);
+    if (value) {
+        g_variant_unref(value);
+    }
+
+    Q_EMIT settingChanged(key, result, initial);
+}
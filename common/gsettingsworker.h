@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef GSETTINGS_WORKER_H
+#define GSETTINGS_WORKER_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QThread>
+#include <QVariant>
+#include <QVector>
+
+#undef signals
+#include <gio/gio.h>
+#define signals Q_SIGNALS
+
+// Watches GSettings keys from its own thread, running a GLib main loop on a
+// private GMainContext. Change notifications therefore don't depend on the
+// application's event dispatcher iterating the default GLib context, and dconf
+// reads happen off the GUI thread. New values are reported with settingChanged(),
+// which reaches receivers living in other threads as a queued signal.
+class GSettingsWorker : public QThread
+{
+    Q_OBJECT
+public:
+    struct WatchedKey {
+        QByteArray schemaId;
+        QByteArray name;
+        int key;
+    };
+
+    explicit GSettingsWorker(const QVector<WatchedKey> &keys, QObject *parent = nullptr);
+    ~GSettingsWorker();
+
+    void stop();
+
+Q_SIGNALS:
+    // Initial is set for the values read when the watch is set up, to catch up
+    // with changes made before it
+    void settingChanged(int key, const QVariant &value, bool initial);
+
+protected:
+    void run() override;
+
+private:
+    static void changed(GSettings *settings, gchar *name, gpointer data);
+    static gboolean quit(gpointer data);
+
+    void reportValue(GSettings *settings, const char *name, bool initial);
+
+    QVector<WatchedKey> m_keys;
+    QHash<QByteArray, int> m_keyIds;
+    GMainContext *m_context;
+    GMainLoop *m_loop;
+};
+
+#endif // GSETTINGS_WORKER_H
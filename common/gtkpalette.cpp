@@ -0,0 +1,664 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gtkpalette.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QLoggingCategory>
+#include <QPair>
+#include <QRegularExpression>
+#include <QStandardPaths>
+#include <QUrl>
+
+#include <cctype>
+
+#undef signals
+#include <gio/gio.h>
+#define signals Q_SIGNALS
+
+Q_DECLARE_LOGGING_CATEGORY(QGnomePlatform)
+
+typedef QHash<QString, QString> ColorDefinitions;
+
+// Limits @import chains and color references, protects against cycles
+static const int maxNesting = 16;
+
+// Adwaita from Gtk 3.24, it's compiled into Gtk so there is no file to read it from
+static const char adwaitaColors[] =
+    "@define-color theme_fg_color #2e3436;"
+    "@define-color theme_text_color black;"
+    "@define-color theme_bg_color #f6f5f4;"
+    "@define-color theme_base_color #ffffff;"
+    "@define-color theme_selected_bg_color #3584e4;"
+    "@define-color theme_selected_fg_color #ffffff;"
+    "@define-color insensitive_bg_color #faf9f8;"
+    "@define-color insensitive_fg_color #929595;"
+    "@define-color insensitive_base_color #fcfcfc;"
+    "@define-color theme_unfocused_fg_color #929595;"
+    "@define-color theme_unfocused_text_color black;"
+    "@define-color theme_unfocused_bg_color #f6f5f4;"
+    "@define-color theme_unfocused_base_color #fcfcfc;"
+    "@define-color theme_unfocused_selected_bg_color #3584e4;"
+    "@define-color theme_unfocused_selected_fg_color #ffffff;"
+    "@define-color borders #cdc7c2;"
+    "@define-color unfocused_borders #d5d0cc;"
+    "@define-color wm_title #2e3436;"
+    "@define-color wm_unfocused_title #929595;"
+    "@define-color wm_bg_a #e1dedb;"
+    "@define-color wm_bg_b #dad6d2;"
+    "@define-color link_color #1b6acb;"
+    "@define-color tooltip_bg_color #313131;"
+    "@define-color tooltip_fg_color #ffffff;";
+
+static const char adwaitaDarkColors[] =
+    "@define-color theme_fg_color #eeeeec;"
+    "@define-color theme_text_color white;"
+    "@define-color theme_bg_color #353535;"
+    "@define-color theme_base_color #2d2d2d;"
+    "@define-color theme_selected_bg_color #15539e;"
+    "@define-color theme_selected_fg_color #ffffff;"
+    "@define-color insensitive_bg_color #323232;"
+    "@define-color insensitive_fg_color #919190;"
+    "@define-color insensitive_base_color #2d2d2d;"
+    "@define-color theme_unfocused_fg_color #919190;"
+    "@define-color theme_unfocused_text_color white;"
+    "@define-color theme_unfocused_bg_color #353535;"
+    "@define-color theme_unfocused_base_color #303030;"
+    "@define-color theme_unfocused_selected_bg_color #15539e;"
+    "@define-color theme_unfocused_selected_fg_color #ffffff;"
+    "@define-color borders #1b1b1b;"
+    "@define-color unfocused_borders #202020;"
+    "@define-color wm_title #eeeeec;"
+    "@define-color wm_unfocused_title #919190;"
+    "@define-color wm_bg_a #2b2b2b;"
+    "@define-color wm_bg_b #262626;"
+    "@define-color link_color #3584e4;"
+    "@define-color tooltip_bg_color #0b0b0b;"
+    "@define-color tooltip_fg_color #ffffff;";
+
+// Colors which themes often leave out, derived from the basic ones the way Adwaita does
+static const char derivedColors[] =
+    "@define-color theme_unfocused_fg_color mix(@theme_fg_color, @theme_bg_color, 0.5);"
+    "@define-color theme_unfocused_text_color @theme_text_color;"
+    "@define-color theme_unfocused_bg_color @theme_bg_color;"
+    "@define-color theme_unfocused_base_color @theme_base_color;"
+    "@define-color theme_unfocused_selected_bg_color @theme_selected_bg_color;"
+    "@define-color theme_unfocused_selected_fg_color @theme_selected_fg_color;"
+    "@define-color insensitive_bg_color mix(@theme_bg_color, @theme_base_color, 0.4);"
+    "@define-color insensitive_fg_color mix(@theme_fg_color, @theme_bg_color, 0.5);"
+    "@define-color insensitive_base_color @theme_base_color;"
+    "@define-color borders shade(@theme_bg_color, 0.8);"
+    "@define-color unfocused_borders @borders;"
+    "@define-color wm_title @theme_fg_color;"
+    "@define-color wm_unfocused_title @theme_unfocused_fg_color;"
+    "@define-color wm_bg_a shade(@theme_bg_color, 0.92);"
+    "@define-color wm_bg_b shade(@theme_bg_color, 0.88);"
+    "@define-color link_color shade(@theme_selected_bg_color, 0.85);"
+    "@define-color tooltip_bg_color mix(@theme_bg_color, black, 0.8);"
+    "@define-color tooltip_fg_color white;";
+
+// Collects @define-color statements in order, later ones override earlier ones,
+// and hands the location of @import statements to the given function
+template <typename ImportHandler>
+static void parseCss(QString css, ColorDefinitions *definitions, ImportHandler import)
+{
+    static const QRegularExpression comment(QStringLiteral("/\\*.*?\\*/"), QRegularExpression::DotMatchesEverythingOption);
+    static const QRegularExpression statement(QStringLiteral("@(import|define-color)\\s+([^;]*);"));
+    static const QRegularExpression importUrl(QStringLiteral("^(?:url\\(\\s*)?[\"']?([^\"')]+)[\"']?"));
+
+    css.remove(comment);
+
+    QRegularExpressionMatchIterator it = statement.globalMatch(css);
+    while (it.hasNext()) {
+        const QRegularExpressionMatch match = it.next();
+        const QString value = match.captured(2).trimmed();
+
+        if (match.capturedRef(1) == QLatin1String("import")) {
+            const QRegularExpressionMatch url = importUrl.match(value);
+            if (url.hasMatch()) {
+                import(url.captured(1).trimmed(), definitions);
+            }
+        } else {
+            const int separator = value.indexOf(QRegularExpression(QStringLiteral("\\s")));
+            if (separator > 0) {
+                definitions->insert(value.left(separator), value.mid(separator + 1).trimmed());
+            }
+        }
+    }
+}
+
+static ColorDefinitions builtinDefinitions(const char *css)
+{
+    ColorDefinitions definitions;
+    parseCss(QString::fromLatin1(css), &definitions, [] (const QString &, ColorDefinitions *) { });
+    return definitions;
+}
+
+// Reads the CSS of a theme, following imports into other files and into the theme's
+// compiled resources, which is where most themes keep their actual style sheet
+class ThemeCssReader
+{
+public:
+    explicit ThemeCssReader(const QString &themeDir)
+    {
+        const QString resourcePath = themeDir + QStringLiteral("/gtk.gresource");
+        if (QFile::exists(resourcePath)) {
+            m_resource = g_resource_load(QFile::encodeName(resourcePath).constData(), nullptr);
+        }
+    }
+
+    ~ThemeCssReader()
+    {
+        if (m_resource) {
+            g_resource_unref(m_resource);
+        }
+    }
+
+    bool read(const QString &location, ColorDefinitions *definitions, int depth = 0)
+    {
+        if (depth > maxNesting) {
+            return false;
+        }
+
+        const QByteArray css = contents(location);
+        if (css.isNull()) {
+            return false;
+        }
+
+        parseCss(QString::fromUtf8(css), definitions, [this, &location, depth] (const QString &reference, ColorDefinitions *target) {
+            read(resolveLocation(location, reference), target, depth + 1);
+        });
+
+        return true;
+    }
+
+private:
+    QByteArray contents(const QString &location) const
+    {
+        if (location.startsWith(QLatin1String("resource://"))) {
+            if (!m_resource) {
+                return QByteArray();
+            }
+
+            GBytes *bytes = g_resource_lookup_data(m_resource, location.mid(11).toUtf8().constData(), G_RESOURCE_LOOKUP_FLAGS_NONE, nullptr);
+            if (!bytes) {
+                return QByteArray();
+            }
+
+            gsize size = 0;
+            const char *data = static_cast<const char *>(g_bytes_get_data(bytes, &size));
+            const QByteArray result(data ? data : "", size);
+            g_bytes_unref(bytes);
+            return result;
+        }
+
+        QFile file(location);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return QByteArray();
+        }
+
+        return file.readAll();
+    }
+
+    static QString resolveLocation(const QString &base, const QString &reference)
+    {
+        if (reference.startsWith(QLatin1String("resource://"))) {
+            return reference;
+        } else if (reference.startsWith(QLatin1String("file://"))) {
+            return QUrl(reference).toLocalFile();
+        } else if (base.startsWith(QLatin1String("resource://"))) {
+            const QString basePath = base.mid(11);
+            return QStringLiteral("resource://") + QDir::cleanPath(basePath.left(basePath.lastIndexOf(QLatin1Char('/')) + 1) + reference);
+        } else if (QDir::isAbsolutePath(reference)) {
+            return reference;
+        }
+
+        return QDir::cleanPath(QFileInfo(base).absolutePath() + QLatin1Char('/') + reference);
+    }
+
+    GResource *m_resource = nullptr;
+};
+
+// Evaluates Gtk CSS color expressions: @name references, #hex, rgb(), rgba(), color
+// names and the shade(), lighter(), darker(), alpha() and mix() functions
+class ColorResolver
+{
+public:
+    explicit ColorResolver(const ColorDefinitions &definitions)
+        : m_definitions(definitions)
+    {
+    }
+
+    QColor resolve(const QString &name)
+    {
+        auto it = m_resolved.constFind(name);
+        if (it != m_resolved.constEnd()) {
+            return it.value();
+        }
+
+        if (m_depth >= maxNesting || !m_definitions.contains(name)) {
+            return QColor();
+        }
+
+        const QString expression = m_definitions.value(name);
+        int pos = 0;
+
+        ++m_depth;
+        QColor color = parseColor(expression, &pos);
+        --m_depth;
+
+        skipSpaces(expression, &pos);
+        if (pos != expression.size()) {
+            color = QColor();
+        }
+
+        m_resolved.insert(name, color);
+        return color;
+    }
+
+private:
+    static void skipSpaces(const QString &text, int *pos)
+    {
+        while (*pos < text.size() && text.at(*pos).isSpace()) {
+            ++*pos;
+        }
+    }
+
+    static bool expect(const QString &text, int *pos, QChar c)
+    {
+        skipSpaces(text, pos);
+        if (*pos < text.size() && text.at(*pos) == c) {
+            ++*pos;
+            return true;
+        }
+        return false;
+    }
+
+    static QString parseIdentifier(const QString &text, int *pos)
+    {
+        const int start = *pos;
+        while (*pos < text.size() && (text.at(*pos).isLetterOrNumber() || text.at(*pos) == QLatin1Char('_') || text.at(*pos) == QLatin1Char('-'))) {
+            ++*pos;
+        }
+        return text.mid(start, *pos - start);
+    }
+
+    static bool parseNumber(const QString &text, int *pos, qreal *value, bool *percentage)
+    {
+        skipSpaces(text, pos);
+
+        const int start = *pos;
+        while (*pos < text.size() && (text.at(*pos).isDigit() || text.at(*pos) == QLatin1Char('.') ||
+                                      (*pos == start && (text.at(*pos) == QLatin1Char('-') || text.at(*pos) == QLatin1Char('+'))))) {
+            ++*pos;
+        }
+
+        bool ok = false;
+        *value = text.midRef(start, *pos - start).toDouble(&ok);
+
+        *percentage = *pos < text.size() && text.at(*pos) == QLatin1Char('%');
+        if (*percentage) {
+            ++*pos;
+        }
+
+        return ok;
+    }
+
+    QColor parseHex(const QString &text, int *pos)
+    {
+        const int start = *pos;
+        while (*pos < text.size() && isxdigit(text.at(*pos).toLatin1())) {
+            ++*pos;
+        }
+
+        QString hex = text.mid(start, *pos - start);
+        if (hex.size() == 4) {
+            hex = QString(hex.at(0)) + hex.at(0) + hex.at(1) + hex.at(1) + hex.at(2) + hex.at(2) + hex.at(3) + hex.at(3);
+        }
+        if (hex.size() == 8) {
+            // CSS puts the alpha last, QColor first
+            hex = hex.right(2) + hex.left(6);
+        }
+
+        return QColor(QLatin1Char('#') + hex);
+    }
+
+    QColor parseColor(const QString &text, int *pos)
+    {
+        skipSpaces(text, pos);
+        if (*pos >= text.size()) {
+            return QColor();
+        }
+
+        if (text.at(*pos) == QLatin1Char('@')) {
+            ++*pos;
+            return resolve(parseIdentifier(text, pos));
+        } else if (text.at(*pos) == QLatin1Char('#')) {
+            ++*pos;
+            return parseHex(text, pos);
+        }
+
+        const QString identifier = parseIdentifier(text, pos);
+        if (identifier.isEmpty()) {
+            return QColor();
+        }
+
+        if (expect(text, pos, QLatin1Char('('))) {
+            return parseFunction(identifier, text, pos);
+        } else if (identifier == QLatin1String("transparent")) {
+            return QColor(Qt::transparent);
+        }
+
+        return QColor::isValidColor(identifier) ? QColor(identifier) : QColor();
+    }
+
+    QColor parseFunction(const QString &function, const QString &text, int *pos)
+    {
+        qreal value = 0;
+        bool percentage = false;
+
+        if (function == QLatin1String("rgb") || function == QLatin1String("rgba")) {
+            qreal channels[4] = { 0, 0, 0, 1 };
+            const int count = function == QLatin1String("rgb") ? 3 : 4;
+            for (int i = 0; i < count; ++i) {
+                if ((i && !expect(text, pos, QLatin1Char(','))) || !parseNumber(text, pos, &channels[i], &percentage)) {
+                    return QColor();
+                }
+                if (percentage) {
+                    channels[i] /= 100;
+                } else if (i < 3) {
+                    channels[i] /= 255;
+                }
+                channels[i] = qBound<qreal>(0, channels[i], 1);
+            }
+
+            if (!expect(text, pos, QLatin1Char(')'))) {
+                return QColor();
+            }
+            return QColor::fromRgbF(channels[0], channels[1], channels[2], channels[3]);
+        }
+
+        const QColor color = parseColor(text, pos);
+        if (!color.isValid()) {
+            return QColor();
+        }
+
+        if (function == QLatin1String("lighter") || function == QLatin1String("darker")) {
+            if (!expect(text, pos, QLatin1Char(')'))) {
+                return QColor();
+            }
+            return GtkPalette::shade(color, function == QLatin1String("lighter") ? 1.3 : 0.7);
+        }
+
+        if (!expect(text, pos, QLatin1Char(','))) {
+            return QColor();
+        }
+
+        if (function == QLatin1String("mix")) {
+            const QColor color2 = parseColor(text, pos);
+            if (!color2.isValid() || !expect(text, pos, QLatin1Char(',')) || !parseNumber(text, pos, &value, &percentage) ||
+                !expect(text, pos, QLatin1Char(')'))) {
+                return QColor();
+            }
+            return GtkPalette::mix(color, color2, value);
+        }
+
+        if (!parseNumber(text, pos, &value, &percentage) || !expect(text, pos, QLatin1Char(')'))) {
+            return QColor();
+        }
+
+        if (function == QLatin1String("shade")) {
+            return GtkPalette::shade(color, value);
+        } else if (function == QLatin1String("alpha")) {
+            QColor result = color;
+            result.setAlphaF(qBound<qreal>(0, color.alphaF() * value, 1));
+            return result;
+        }
+
+        return QColor();
+    }
+
+    const ColorDefinitions &m_definitions;
+    QHash<QString, QColor> m_resolved;
+    int m_depth = 0;
+};
+
+struct PaletteCache
+{
+    ~PaletteCache()
+    {
+        qDeleteAll(palettes);
+    }
+
+    QHash<QPair<QString, bool>, GtkPalette *> palettes;
+};
+
+Q_GLOBAL_STATIC(PaletteCache, paletteCache)
+
+// The gtk-3.0 directory of the theme, searched where Gtk does
+static QString themeDirectory(const QString &theme)
+{
+    if (theme.isEmpty()) {
+        return QString();
+    }
+
+    QStringList roots;
+    roots << QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + QStringLiteral("/themes")
+          << QDir::homePath() + QStringLiteral("/.themes");
+    for (const QString &dataDir : QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation)) {
+        roots << dataDir + QStringLiteral("/themes");
+    }
+
+    for (const QString &root : roots) {
+        const QString dir = QStringLiteral("%1/%2/gtk-3.0").arg(root).arg(theme);
+        if (QFileInfo(dir).isDir()) {
+            return dir;
+        }
+    }
+
+    return QString();
+}
+
+const GtkPalette *GtkPalette::forTheme(const QString &theme, bool darkVariant)
+{
+    const QPair<QString, bool> key(theme, darkVariant);
+
+    GtkPalette *palette = paletteCache()->palettes.value(key);
+    if (!palette) {
+        palette = new GtkPalette(theme, darkVariant);
+        paletteCache()->palettes.insert(key, palette);
+    }
+
+    return palette;
+}
+
+const GtkPalette *GtkPalette::fromColors(const QString &theme, bool darkVariant, const QHash<QString, QColor> &colors)
+{
+    const QPair<QString, bool> key(theme, darkVariant);
+
+    GtkPalette *palette = paletteCache()->palettes.value(key);
+    if (!palette) {
+        palette = new GtkPalette(darkVariant, colors);
+        paletteCache()->palettes.insert(key, palette);
+    }
+
+    return palette;
+}
+
+GtkPalette::GtkPalette(bool darkVariant, const QHash<QString, QColor> &colors)
+    : m_darkVariant(darkVariant)
+    , m_colors(colors)
+{
+    buildPalette();
+}
+
+GtkPalette::GtkPalette(const QString &theme, bool darkVariant)
+    : m_darkVariant(darkVariant)
+{
+    ColorDefinitions definitions;
+
+    const QString themeDir = themeDirectory(theme);
+    if (!themeDir.isEmpty()) {
+        ThemeCssReader reader(themeDir);
+
+        // Like Gtk, use the regular style sheet when the theme has no dark one
+        if (!darkVariant || !reader.read(themeDir + QStringLiteral("/gtk-dark.css"), &definitions)) {
+            reader.read(themeDir + QStringLiteral("/gtk.css"), &definitions);
+        }
+    }
+
+    qCDebug(QGnomePlatform) << "Colors defined by theme " << theme << ": " << definitions.count();
+
+    const ColorDefinitions adwaita = builtinDefinitions(darkVariant ? adwaitaDarkColors : adwaitaColors);
+
+    // Adwaita itself, or a theme we couldn't read anything from
+    if (definitions.isEmpty()) {
+        definitions = adwaita;
+    }
+
+    // Fill in what the theme doesn't define, from its own colors if possible
+    for (const ColorDefinitions &fallback : { builtinDefinitions(derivedColors), adwaita }) {
+        for (auto it = fallback.constBegin(); it != fallback.constEnd(); ++it) {
+            if (!definitions.contains(it.key())) {
+                definitions.insert(it.key(), it.value());
+            }
+        }
+    }
+
+    ColorResolver resolver(definitions);
+    for (auto it = definitions.constBegin(); it != definitions.constEnd(); ++it) {
+        const QColor color = resolver.resolve(it.key());
+        if (color.isValid()) {
+            m_colors.insert(it.key(), color);
+        }
+    }
+
+    // Expressions we don't understand shouldn't leave the palette incomplete
+    ColorResolver adwaitaResolver(adwaita);
+    for (auto it = adwaita.constBegin(); it != adwaita.constEnd(); ++it) {
+        if (!m_colors.contains(it.key())) {
+            m_colors.insert(it.key(), adwaitaResolver.resolve(it.key()));
+        }
+    }
+
+    buildPalette();
+}
+
+QColor GtkPalette::color(const QString &name) const
+{
+    return m_colors.value(name);
+}
+
+void GtkPalette::buildPalette()
+{
+    const QColor background = color(QStringLiteral("theme_bg_color"));
+    const QColor link = color(QStringLiteral("link_color"));
+
+    // Shared by all groups, derived from the window background like QPalette does
+    m_palette.setColor(QPalette::Light, background.lighter(150));
+    m_palette.setColor(QPalette::Midlight, background.lighter(125));
+    m_palette.setColor(QPalette::Mid, background.darker(150));
+    m_palette.setColor(QPalette::Dark, background.darker(200));
+    m_palette.setColor(QPalette::Shadow, background.darker(300));
+    m_palette.setColor(QPalette::BrightText, color(QStringLiteral("theme_selected_fg_color")));
+    m_palette.setColor(QPalette::Link, link);
+    m_palette.setColor(QPalette::LinkVisited, darken(link, 0.1));
+    m_palette.setColor(QPalette::ToolTipBase, color(QStringLiteral("tooltip_bg_color")));
+    m_palette.setColor(QPalette::ToolTipText, color(QStringLiteral("tooltip_fg_color")));
+
+    const struct {
+        QPalette::ColorGroup group;
+        const char *window;
+        const char *windowText;
+        const char *base;
+        const char *text;
+        const char *highlight;
+        const char *highlightedText;
+    } groups[] = {
+        { QPalette::Active, "theme_bg_color", "theme_fg_color", "theme_base_color", "theme_text_color",
+          "theme_selected_bg_color", "theme_selected_fg_color" },
+        { QPalette::Inactive, "theme_unfocused_bg_color", "theme_unfocused_fg_color", "theme_unfocused_base_color", "theme_unfocused_text_color",
+          "theme_unfocused_selected_bg_color", "theme_unfocused_selected_fg_color" },
+        { QPalette::Disabled, "insensitive_bg_color", "insensitive_fg_color", "insensitive_base_color", "insensitive_fg_color",
+          "theme_unfocused_selected_bg_color", "insensitive_fg_color" }
+    };
+
+    for (const auto &group : groups) {
+        const QColor window = color(QLatin1String(group.window));
+        const QColor windowText = color(QLatin1String(group.windowText));
+        const QColor base = color(QLatin1String(group.base));
+
+        m_palette.setColor(group.group, QPalette::Window, window);
+        m_palette.setColor(group.group, QPalette::WindowText, windowText);
+        m_palette.setColor(group.group, QPalette::Button, window);
+        m_palette.setColor(group.group, QPalette::ButtonText, windowText);
+        m_palette.setColor(group.group, QPalette::Base, base);
+        m_palette.setColor(group.group, QPalette::AlternateBase, mix(base, window, 0.5));
+        m_palette.setColor(group.group, QPalette::Text, color(QLatin1String(group.text)));
+        m_palette.setColor(group.group, QPalette::Highlight, color(QLatin1String(group.highlight)));
+        m_palette.setColor(group.group, QPalette::HighlightedText, color(QLatin1String(group.highlightedText)));
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+        m_palette.setColor(group.group, QPalette::PlaceholderText, mix(windowText, window, 0.5));
+#endif
+    }
+}
+
+QColor GtkPalette::shade(const QColor &color, qreal factor)
+{
+    qreal h, s, l, a;
+    color.getHslF(&h, &s, &l, &a);
+
+    return QColor::fromHslF(h, qBound<qreal>(0, s * factor, 1), qBound<qreal>(0, l * factor, 1), a);
+}
+
+QColor GtkPalette::mix(const QColor &color1, const QColor &color2, qreal amount)
+{
+    amount = qBound<qreal>(0, amount, 1);
+
+    return QColor::fromRgbF(color1.redF() + (color2.redF() - color1.redF()) * amount,
+                            color1.greenF() + (color2.greenF() - color1.greenF()) * amount,
+                            color1.blueF() + (color2.blueF() - color1.blueF()) * amount,
+                            color1.alphaF() + (color2.alphaF() - color1.alphaF()) * amount);
+}
+
+// Copied from adwaita-qt
+QColor GtkPalette::darken(const QColor &color, qreal amount)
+{
+    qreal h, s, l, a;
+    color.getHslF(&h, &s, &l, &a);
+
+    qreal lightness = l - amount;
+    if (lightness < 0)
+        lightness = 0;
+
+    return QColor::fromHslF(h, s, lightness, a);
+}
+
+QColor GtkPalette::transparentize(const QColor &color, qreal amount)
+{
+    qreal h, s, l, a;
+    color.getHslF(&h, &s, &l, &a);
+
+    qreal alpha = a - amount;
+    if (alpha < 0)
+        alpha = 0;
+    return QColor::fromHslF(h, s, l, alpha);
+}
@@ -0,0 +1,76 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef GTK_PALETTE_H
+#define GTK_PALETTE_H
+
+#include <QColor>
+#include <QHash>
+#include <QPalette>
+#include <QString>
+
+// Named colors of a Gtk theme (@define-color in its gtk.css), with the ones the theme
+// doesn't define derived from the others or taken from Adwaita, and the QPalette made
+// from them. Resolved palettes are cached per theme and variant for the life time of
+// the process, so the returned pointer stays valid.
+class GtkPalette
+{
+public:
+    static const GtkPalette *forTheme(const QString &theme, bool darkVariant);
+
+    // Restores a palette from the colors it was resolved to before, without reading
+    // the theme again
+    static const GtkPalette *fromColors(const QString &theme, bool darkVariant, const QHash<QString, QColor> &colors);
+
+    // Invalid color when the name is unknown
+    QColor color(const QString &name) const;
+
+    inline const QHash<QString, QColor> &colors() const
+    {
+        return m_colors;
+    }
+
+    inline const QPalette &palette() const
+    {
+        return m_palette;
+    }
+
+    inline bool isDarkVariant() const
+    {
+        return m_darkVariant;
+    }
+
+    // Color transformations, the ones from Gtk CSS and from adwaita-qt
+    static QColor shade(const QColor &color, qreal factor);
+    static QColor mix(const QColor &color1, const QColor &color2, qreal amount);
+    static QColor darken(const QColor &color, qreal amount = 0.1);
+    static QColor transparentize(const QColor &color, qreal amount = 0.1);
+
+private:
+    GtkPalette(const QString &theme, bool darkVariant);
+    GtkPalette(bool darkVariant, const QHash<QString, QColor> &colors);
+
+    void buildPalette();
+
+    bool m_darkVariant;
+    QHash<QString, QColor> m_colors;
+    QPalette m_palette;
+};
+
+#endif // GTK_PALETTE_H
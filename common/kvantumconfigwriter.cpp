@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "kvantumconfigwriter.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QLoggingCategory>
+#include <QMutex>
+#include <QSaveFile>
+#include <QThreadPool>
+
+Q_DECLARE_LOGGING_CATEGORY(QGnomePlatform)
+
+// A single thread, so writes for consecutive theme changes happen in order.
+// The pool waits for a pending write when destroyed at exit.
+Q_GLOBAL_STATIC(QThreadPool, writerPool)
+
+static QMutex s_lastThemeMutex;
+static QString s_lastTheme;
+
+void KvantumConfigWriter::setTheme(const QString &theme)
+{
+    {
+        // Every settings reload asks for the same theme again, only the first one needs a look at the file
+        QMutexLocker locker(&s_lastThemeMutex);
+        if (s_lastTheme == theme) {
+            return;
+        }
+        s_lastTheme = theme;
+    }
+
+    writerPool()->setMaxThreadCount(1);
+    writerPool()->start(new KvantumConfigWriter(theme));
+}
+
+KvantumConfigWriter::KvantumConfigWriter(const QString &theme)
+    : m_theme(theme)
+{
+}
+
+void KvantumConfigWriter::run()
+{
+    const QString path = configPath();
+
+    QByteArray config;
+    QFile file(path);
+    if (file.open(QIODevice::ReadOnly)) {
+        config = file.readAll();
+        file.close();
+    }
+
+    if (!updateConfig(&config, m_theme.toUtf8())) {
+        // Already set, don't touch the file
+        return;
+    }
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // Written to a temporary file and renamed over, so Kvantum never reads a partial config
+    QSaveFile saveFile(path);
+    if (!saveFile.open(QIODevice::WriteOnly) || saveFile.write(config) != config.size() || !saveFile.commit()) {
+        qCWarning(QGnomePlatform) << "Failed to write Kvantum configuration to " << path;
+    }
+}
+
+QString KvantumConfigWriter::configPath()
+{
+    return QDir::homePath() + QStringLiteral("/.config/Kvantum/kvantum.kvconfig");
+}
+
+bool KvantumConfigWriter::updateConfig(QByteArray *config, const QByteArray &theme)
+{
+    // The file is written by QSettings, which puts keys without a group into [General].
+    // Only that group is of interest, everything else is kept byte for byte.
+    QList<QByteArray> lines = config->split('\n');
+    if (!lines.isEmpty() && lines.last().isEmpty()) {
+        lines.removeLast();
+    }
+
+    int generalLine = -1;
+    int generalEnd = -1;
+    bool inGeneral = false;
+
+    for (int i = 0; i < lines.count(); ++i) {
+        const QByteArray line = lines.at(i).trimmed();
+
+        if (line.startsWith('[')) {
+            if (inGeneral) {
+                generalEnd = i;
+            }
+            inGeneral = line == "[General]";
+            if (inGeneral) {
+                generalLine = i;
+            }
+            continue;
+        }
+
+        if (!inGeneral) {
+            continue;
+        }
+
+        const int separator = line.indexOf('=');
+        if (separator == -1 || line.left(separator).trimmed() != "theme") {
+            continue;
+        }
+
+        QByteArray value = line.mid(separator + 1).trimmed();
+        if (value.size() >= 2 && value.startsWith('"') && value.endsWith('"')) {
+            value = value.mid(1, value.size() - 2);
+        }
+
+        if (value == theme) {
+            return false;
+        }
+
+        lines[i] = "theme=" + theme;
+        *config = lines.join('\n') + '\n';
+        return true;
+    }
+
+    if (generalLine == -1) {
+        // QSettings writes [General] first
+        lines.prepend(QByteArray());
+        lines.prepend("theme=" + theme);
+        lines.prepend("[General]");
+        if (lines.count() == 3) {
+            lines.removeLast();
+        }
+    } else {
+        // Keep the blank line separating the next group
+        int insertAt = generalEnd == -1 ? lines.count() : generalEnd;
+        while (insertAt > generalLine + 1 && lines.at(insertAt - 1).trimmed().isEmpty()) {
+            --insertAt;
+        }
+        lines.insert(insertAt, "theme=" + theme);
+    }
+
+    *config = lines.join('\n') + '\n';
+    return true;
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef KVANTUM_CONFIG_WRITER_H
+#define KVANTUM_CONFIG_WRITER_H
+
+#include <QByteArray>
+#include <QRunnable>
+#include <QString>
+
+// Sets the theme in the user's Kvantum configuration from a background thread.
+// The file is only rewritten, atomically, when it doesn't have the theme already.
+class KvantumConfigWriter : public QRunnable
+{
+public:
+    static void setTheme(const QString &theme);
+
+    void run() override;
+
+private:
+    explicit KvantumConfigWriter(const QString &theme);
+
+    static QString configPath();
+    static bool updateConfig(QByteArray *config, const QByteArray &theme);
+
+    QString m_theme;
+};
+
+#endif // KVANTUM_CONFIG_WRITER_H
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "phasetrace.h"
+
+#include <QLoggingCategory>
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+Q_DECLARE_LOGGING_CATEGORY(QGnomePlatform)
+
+// Either a file the events are appended to, or -1 to log them
+static int s_traceFd = -1;
+
+bool PhaseTrace::initialize()
+{
+    const QByteArray path = qgetenv("QGNOMEPLATFORM_TRACE");
+    if (!path.isEmpty()) {
+        // The theme and the decoration plugins both append to the file. Whoever
+        // creates it opens the array, the closing bracket is optional in the
+        // trace event format so nobody has to write it at exit.
+        int fd = open(path.constData(), O_WRONLY | O_APPEND | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            if (write(fd, "[\n", 2) != 2) {
+                close(fd);
+                fd = -1;
+            }
+        } else {
+            fd = open(path.constData(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        }
+
+        if (fd >= 0) {
+            s_traceFd = fd;
+            return true;
+        }
+
+        qCWarning(QGnomePlatform) << "Failed to open the trace file " << path;
+    }
+
+    return QGnomePlatform().isDebugEnabled();
+}
+
+qint64 PhaseTrace::now()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return qint64(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+void PhaseTrace::complete(const char *name, qint64 start, qint64 duration)
+{
+    char event[256];
+    const int length = snprintf(event, sizeof(event),
+                                "{\"name\":\"%s\",\"cat\":\"qgnomeplatform\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%ld},\n",
+                                name, static_cast<long long>(start), static_cast<long long>(duration),
+                                int(getpid()), long(syscall(SYS_gettid)));
+    if (length <= 0 || length >= int(sizeof(event))) {
+        return;
+    }
+
+    if (s_traceFd >= 0) {
+        // A single write to an O_APPEND file keeps lines from other threads and
+        // the other plugin whole
+        if (write(s_traceFd, event, size_t(length)) != length) {
+            qCWarning(QGnomePlatform) << "Failed to write the trace event " << name;
+        }
+    } else {
+        qCDebug(QGnomePlatform).noquote() << QLatin1String(event, length - 2);
+    }
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef PHASE_TRACE_H
+#define PHASE_TRACE_H
+
+#include <QtGlobal>
+
+// Opt-in timing of the startup and settings change phases, written as Chrome
+// trace events so it can be loaded into chrome://tracing or Perfetto next to the
+// application's own trace. QGNOMEPLATFORM_TRACE=<file> appends the events to the
+// file, with debug output of qt.qpa.qgnomeplatform enabled they go to the log.
+//
+// Timestamps are CLOCK_MONOTONIC microseconds, the clock other Linux tracers use,
+// so the theme and decoration plugins and the application line up.
+class PhaseTrace
+{
+public:
+    static bool isEnabled()
+    {
+        static const bool enabled = initialize();
+        return enabled;
+    }
+
+    static qint64 now();
+
+    // Records a complete ("X") event, name must be a string literal
+    static void complete(const char *name, qint64 start, qint64 duration);
+
+private:
+    static bool initialize();
+};
+
+// Times the enclosing scope. When tracing is off this costs a single check of a
+// cached flag, so scopes can stay in release builds.
+class PhaseTraceScope
+{
+public:
+    explicit PhaseTraceScope(const char *name)
+        : m_name(PhaseTrace::isEnabled() ? name : nullptr)
+        , m_start(m_name ? PhaseTrace::now() : 0)
+    {
+    }
+
+    ~PhaseTraceScope()
+    {
+        if (m_name) {
+            PhaseTrace::complete(m_name, m_start, PhaseTrace::now() - m_start);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(PhaseTraceScope)
+
+    const char *m_name;
+    qint64 m_start;
+};
+
+#endif // PHASE_TRACE_H
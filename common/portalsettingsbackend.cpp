@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "portalsettingsbackend.h"
+#include "phasetrace.h"
+#include "runtimestats.h"
+
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCall>
+#include <QDBusPendingCallWatcher>
+#include <QLoggingCategory>
+#include <QStringList>
+
+Q_DECLARE_LOGGING_CATEGORY(QGnomePlatform)
+
+const QDBusArgument &operator>>(const QDBusArgument &argument, QMap<QString, QVariantMap> &map)
+{
+    argument.beginMap();
+    map.clear();
+
+    while (!argument.atEnd()) {
+        QString key;
+        QVariantMap value;
+        argument.beginMapEntry();
+        argument >> key >> value;
+        argument.endMapEntry();
+        map.insert(key, value);
+    }
+
+    argument.endMap();
+    return argument;
+}
+
+// The portal exposes the GNOME settings whatever the desktop, and we only use these
+static QStringList portalGroups()
+{
+    return { QStringLiteral("org.gnome.desktop.interface"), QStringLiteral("org.gnome.desktop.wm.preferences") };
+}
+
+PortalSettingsBackend::PortalSettingsBackend(SettingsBackend *fallback, QObject *parent)
+    : SettingsBackend(parent)
+    , m_fallback(fallback)
+{
+    m_fallback->setParent(this);
+    connect(m_fallback, &SettingsBackend::valueChanged, this, &PortalSettingsBackend::fallbackValueChanged);
+
+    QDBusMessage message = QDBusMessage::createMethodCall(QStringLiteral("org.freedesktop.portal.Desktop"),
+                                                          QStringLiteral("/org/freedesktop/portal/desktop"),
+                                                          QStringLiteral("org.freedesktop.portal.Settings"),
+                                                          QStringLiteral("ReadAll"));
+    message << portalGroups();
+
+    // The call is asynchronous, it's traced from here until the reply arrives
+    m_readAllStart = PhaseTrace::isEnabled() ? PhaseTrace::now() : 0;
+    RuntimeStats::count(RuntimeStats::PortalReads);
+    QDBusPendingCall pendingCall = QDBusConnection::sessionBus().asyncCall(message);
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(pendingCall, this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &PortalSettingsBackend::portalSettingsReceived);
+
+    // Only subscribe to the namespaces we use, not to every setting change on the desktop
+    for (const QString &group : portalGroups()) {
+        QDBusConnection::sessionBus().connect(QString(), QStringLiteral("/org/freedesktop/portal/desktop"), QStringLiteral("org.freedesktop.portal.Settings"),
+                                              QStringLiteral("SettingChanged"), { group }, QStringLiteral("ssv"),
+                                              this, SLOT(portalSettingChanged(QString,QString,QDBusVariant)));
+    }
+}
+
+const char *PortalSettingsBackend::name() const
+{
+    return "portal";
+}
+
+void PortalSettingsBackend::readAll(QVariant *values)
+{
+    m_fallback->readAll(values);
+
+    for (int key = 0; key < GnomeHintsSettings::SettingKeyCount; ++key) {
+        if (m_portalValues[key].isValid()) {
+            values[key] = m_portalValues[key];
+        }
+        m_values[key] = values[key];
+    }
+}
+
+void PortalSettingsBackend::watch(const QVariant *values)
+{
+    // Changes the fallback reports for keys the portal has are ignored anyway
+    m_fallback->watch(values);
+}
+
+bool PortalSettingsBackend::isCacheable() const
+{
+    // Portal values arrive after the startup
+    return false;
+}
+
+void PortalSettingsBackend::setValue(SettingKey key, const QVariant &value)
+{
+    if (m_values[key] != value) {
+        m_values[key] = value;
+        Q_EMIT valueChanged(key, value);
+    }
+}
+
+void PortalSettingsBackend::fallbackValueChanged(GnomeHintsSettings::SettingKey key, const QVariant &value)
+{
+    if (!m_portalValues[key].isValid()) {
+        setValue(key, value);
+    }
+}
+
+void PortalSettingsBackend::portalSettingChanged(const QString &group, const QString &key, const QDBusVariant &value)
+{
+    if (!portalGroups().contains(group)) {
+        return;
+    }
+
+    const SettingKey settingKey = GnomeHintsSettings::settingKeyFromName(key.toUtf8().constData());
+    if (settingKey != GnomeHintsSettings::SettingKeyCount) {
+        m_portalValues[settingKey] = value.variant();
+        setValue(settingKey, value.variant());
+    }
+}
+
+void PortalSettingsBackend::portalSettingsReceived(QDBusPendingCallWatcher *watcher)
+{
+    watcher->deleteLater();
+
+    if (m_readAllStart) {
+        PhaseTrace::complete("portal ReadAll", m_readAllStart, PhaseTrace::now() - m_readAllStart);
+    }
+
+    const QDBusMessage resultMessage = watcher->reply();
+    if (resultMessage.type() != QDBusMessage::ReplyMessage || resultMessage.arguments().isEmpty()) {
+        qCWarning(QGnomePlatform) << "Failed to read portal settings: " << resultMessage.errorMessage();
+        return;
+    }
+
+    QMap<QString, QVariantMap> portalSettings;
+    const QDBusArgument dbusArgument = resultMessage.arguments().at(0).value<QDBusArgument>();
+    dbusArgument >> portalSettings;
+
+    for (auto group = portalSettings.constBegin(); group != portalSettings.constEnd(); ++group) {
+        for (auto it = group.value().constBegin(); it != group.value().constEnd(); ++it) {
+            const SettingKey key = GnomeHintsSettings::settingKeyFromName(it.key().toUtf8().constData());
+            // A SettingChanged received before the reply is newer than what the reply has
+            if (key == GnomeHintsSettings::SettingKeyCount || m_portalValues[key].isValid()) {
+                continue;
+            }
+
+            m_portalValues[key] = it.value();
+            setValue(key, it.value());
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef PORTAL_SETTINGS_BACKEND_H
+#define PORTAL_SETTINGS_BACKEND_H
+
+#include "settingsbackend.h"
+
+#include <QDBusVariant>
+
+class QDBusPendingCallWatcher;
+
+// Settings from xdg-desktop-portal, for sandboxed applications. Reading them
+// doesn't block the startup, the desktop backend is used until they arrive and
+// for whatever the portal doesn't have.
+class PortalSettingsBackend : public SettingsBackend
+{
+    Q_OBJECT
+public:
+    PortalSettingsBackend(SettingsBackend *fallback, QObject *parent = nullptr);
+
+    const char *name() const override;
+    void readAll(QVariant *values) override;
+    void watch(const QVariant *values) override;
+    bool isCacheable() const override;
+
+private Q_SLOTS:
+    void fallbackValueChanged(GnomeHintsSettings::SettingKey key, const QVariant &value);
+    void portalSettingChanged(const QString &group, const QString &key, const QDBusVariant &value);
+    void portalSettingsReceived(QDBusPendingCallWatcher *watcher);
+
+private:
+    void setValue(SettingKey key, const QVariant &value);
+
+    SettingsBackend *m_fallback;
+    QVariant m_portalValues[GnomeHintsSettings::SettingKeyCount];
+    QVariant m_values[GnomeHintsSettings::SettingKeyCount];
+    qint64 m_readAllStart = 0;
+};
+
+#endif // PORTAL_SETTINGS_BACKEND_H
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "powerprofilemonitor.h"
+
+#include <QDBusMessage>
+#include <QDBusPendingCall>
+#include <QDBusPendingCallWatcher>
+#include <QDBusVariant>
+#include <QLoggingCategory>
+#include <QStringList>
+
+Q_DECLARE_LOGGING_CATEGORY(QGnomePlatform)
+
+static const char *powerProfilesService = "net.hadess.PowerProfiles";
+static const char *powerProfilesPath = "/net/hadess/PowerProfiles";
+static const char *powerProfilesInterface = "net.hadess.PowerProfiles";
+
+PowerProfileMonitor::PowerProfileMonitor(const QDBusConnection &connection, QObject *parent)
+    : QObject(parent)
+    , m_connection(connection)
+{
+    m_connection.connect(QLatin1String(powerProfilesService), QLatin1String(powerProfilesPath),
+                         QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("PropertiesChanged"),
+                         this, SLOT(propertiesChanged(QString,QVariantMap,QStringList)));
+
+    QDBusMessage message = QDBusMessage::createMethodCall(QLatin1String(powerProfilesService), QLatin1String(powerProfilesPath),
+                                                          QStringLiteral("org.freedesktop.DBus.Properties"), QStringLiteral("Get"));
+    message << QLatin1String(powerProfilesInterface) << QStringLiteral("ActiveProfile");
+
+    QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_connection.asyncCall(message), this);
+    connect(watcher, &QDBusPendingCallWatcher::finished, this, &PowerProfileMonitor::profileReceived);
+}
+
+bool PowerProfileMonitor::isPowerSaver() const
+{
+    return m_powerSaver;
+}
+
+void PowerProfileMonitor::profileReceived(QDBusPendingCallWatcher *watcher)
+{
+    watcher->deleteLater();
+
+    const QDBusMessage reply = watcher->reply();
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().isEmpty()) {
+        qCDebug(QGnomePlatform) << "Failed to read the power profile: " << reply.errorMessage();
+        return;
+    }
+
+    setProfile(reply.arguments().at(0).value<QDBusVariant>().variant().toString());
+}
+
+void PowerProfileMonitor::propertiesChanged(const QString &interface, const QVariantMap &changed, const QStringList &invalidated)
+{
+    Q_UNUSED(invalidated);
+
+    if (interface == QLatin1String(powerProfilesInterface) && changed.contains(QStringLiteral("ActiveProfile"))) {
+        setProfile(changed.value(QStringLiteral("ActiveProfile")).toString());
+    }
+}
+
+void PowerProfileMonitor::setProfile(const QString &profile)
+{
+    qCDebug(QGnomePlatform) << "Power profile: " << profile;
+
+    const bool powerSaver = profile == QStringLiteral("power-saver");
+    if (m_powerSaver != powerSaver) {
+        m_powerSaver = powerSaver;
+        Q_EMIT powerSaverChanged(powerSaver);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef POWER_PROFILE_MONITOR_H
+#define POWER_PROFILE_MONITOR_H
+
+#include <QDBusConnection>
+#include <QObject>
+#include <QVariantMap>
+
+class QDBusPendingCallWatcher;
+
+// Follows the active profile of power-profiles-daemon. The profile is read
+// asynchronously, until the reply arrives the power saver is assumed to be off.
+class PowerProfileMonitor : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PowerProfileMonitor(const QDBusConnection &connection, QObject *parent = nullptr);
+
+    bool isPowerSaver() const;
+
+Q_SIGNALS:
+    void powerSaverChanged(bool powerSaver);
+
+private Q_SLOTS:
+    void profileReceived(QDBusPendingCallWatcher *watcher);
+    void propertiesChanged(const QString &interface, const QVariantMap &changed, const QStringList &invalidated);
+
+private:
+    void setProfile(const QString &profile);
+
+    QDBusConnection m_connection;
+    bool m_powerSaver = false;
+};
+
+#endif // POWER_PROFILE_MONITOR_H
@@ -38,6 +38,8 @@
 ****************************************************************************/
 
 #include "qgtk3dialoghelpers.h"
+#include "phasetrace.h"
+#include "runtimestats.h"
 
 #include <qeventloop.h>
 #include <qwindow.h>
@@ -56,6 +58,40 @@
 
 QT_BEGIN_NAMESPACE
 
+static void gtkMessageHandler(const gchar *log_domain,
+                              GLogLevelFlags log_level,
+                              const gchar *message,
+                              gpointer unused_data) {
+    /* Silence false-positive Gtk warnings (we are using Xlib to set
+     * the WM_TRANSIENT_FOR hint).
+     */
+    if (g_strcmp0(message, "GtkDialog mapped without a transient parent. "
+                           "This is discouraged.") != 0) {
+        /* For other messages, call the default handler. */
+        g_log_default_handler(log_domain, log_level, message, unused_data);
+    }
+}
+
+/* GTK is only needed for the dialogs, so it's brought up when the first one
+ * is created instead of in every application using the platform theme.
+ */
+static void ensureGtkInitialized()
+{
+    static bool initialized = false;
+    if (initialized)
+        return;
+
+    {
+        PhaseTraceScope trace("gtk_init");
+        gtk_init(nullptr, nullptr);
+    }
+
+    // Set log handler to suppress false GtkDialog warnings
+    g_log_set_handler("Gtk", G_LOG_LEVEL_MESSAGE, gtkMessageHandler, NULL);
+
+    initialized = true;
+}
+
 class QGtk3Dialog : public QWindow
 {
     Q_OBJECT
@@ -117,6 +153,8 @@ void QGtk3Dialog::exec()
 
 bool QGtk3Dialog::show(Qt::WindowFlags flags, Qt::WindowModality modality, QWindow *parent)
 {
+    RuntimeStats::count(RuntimeStats::DialogOpens);
+
     if (parent) {
         connect(parent, &QWindow::destroyed, this, &QGtk3Dialog::onParentWindowDestroyed,
             Qt::UniqueConnection);
@@ -171,6 +209,8 @@ void QGtk3Dialog::onParentWindowDestroyed()
 
 QGtk3ColorDialogHelper::QGtk3ColorDialogHelper()
 {
+    ensureGtkInitialized();
+
     d.reset(new QGtk3Dialog(gtk_color_chooser_dialog_new("", 0)));
     connect(d.data(), SIGNAL(accept()), this, SLOT(onAccepted()));
     connect(d.data(), SIGNAL(reject()), this, SIGNAL(reject()));
@@ -241,6 +281,8 @@ void QGtk3ColorDialogHelper::applyOptions()
 
 QGtk3FileDialogHelper::QGtk3FileDialogHelper()
 {
+    ensureGtkInitialized();
+
     d.reset(new QGtk3Dialog(gtk_file_chooser_dialog_new("", 0,
                                                         GTK_FILE_CHOOSER_ACTION_OPEN,
                                                         GTK_STOCK_CANCEL, GTK_RESPONSE_CANCEL,
@@ -492,6 +534,8 @@ void QGtk3FileDialogHelper::setNameFilters(const QStringList &filters)
 
 QGtk3FontDialogHelper::QGtk3FontDialogHelper()
 {
+    ensureGtkInitialized();
+
     d.reset(new QGtk3Dialog(gtk_font_chooser_dialog_new("", 0)));
     connect(d.data(), SIGNAL(accept()), this, SLOT(onAccepted()));
     connect(d.data(), SIGNAL(reject()), this, SIGNAL(reject()));
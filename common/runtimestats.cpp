@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "runtimestats.h"
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QLoggingCategory>
+#include <QSocketNotifier>
+#include <QStringList>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+Q_DECLARE_LOGGING_CATEGORY(QGnomePlatform)
+
+static const char *counterNames[RuntimeStats::CounterCount] = {
+    "themeHint calls",
+    "font calls",
+    "palette calls",
+    "GSettings reads",
+    "dconf reads",
+    "xfconf reads",
+    "portal reads",
+    "setting changes received",
+    "change batches applied",
+    "widget invalidation passes",
+    "decoration paints",
+    "decoration paint time (us)",
+    "button pixmap cache hits",
+    "button pixmap cache misses",
+    "dialogs opened"
+};
+
+// Like the settings, the counters are shared between the theme and the decoration
+// plugins through the application object
+static const char *sharedStatsProperty = "_q_qgnomeplatform_stats";
+static std::atomic<RuntimeStats *> s_instance { nullptr };
+
+static int s_signalPipe[2] = { -1, -1 };
+
+static void handleDumpSignal(int)
+{
+    // Only async-signal-safe calls here, the notifier does the dumping
+    const char byte = 0;
+    const ssize_t written = write(s_signalPipe[1], &byte, 1);
+    Q_UNUSED(written);
+}
+
+class StatsExporter : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.qgnomeplatform.Stats")
+public:
+    StatsExporter(bool onSignal, bool onBus, QObject *parent);
+    ~StatsExporter();
+
+public Q_SLOTS:
+    Q_SCRIPTABLE QString Dump() const;
+
+private Q_SLOTS:
+    void signalReceived();
+
+private:
+    QSocketNotifier *m_notifier = nullptr;
+    bool m_registered = false;
+};
+
+StatsExporter::StatsExporter(bool onSignal, bool onBus, QObject *parent)
+    : QObject(parent)
+{
+    if (onSignal) {
+        struct sigaction current;
+        sigaction(SIGUSR2, nullptr, &current);
+
+        // Leave the signal alone if the application handles it itself
+        if (current.sa_handler != SIG_DFL) {
+            qCWarning(QGnomePlatform) << "SIGUSR2 is already handled, not dumping statistics on it";
+        } else if (pipe2(s_signalPipe, O_CLOEXEC | O_NONBLOCK) == 0) {
+            m_notifier = new QSocketNotifier(s_signalPipe[0], QSocketNotifier::Read, this);
+            connect(m_notifier, &QSocketNotifier::activated, this, &StatsExporter::signalReceived);
+
+            struct sigaction action = {};
+            action.sa_handler = handleDumpSignal;
+            action.sa_flags = SA_RESTART;
+            sigemptyset(&action.sa_mask);
+            sigaction(SIGUSR2, &action, nullptr);
+        }
+    }
+
+    if (onBus) {
+        m_registered = QDBusConnection::sessionBus().registerObject(QStringLiteral("/QGnomePlatform/Stats"), this,
+                                                                    QDBusConnection::ExportScriptableSlots);
+        if (!m_registered) {
+            qCWarning(QGnomePlatform) << "Failed to export statistics on the session bus";
+        }
+    }
+}
+
+StatsExporter::~StatsExporter()
+{
+    if (m_registered) {
+        QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/QGnomePlatform/Stats"));
+    }
+
+    if (m_notifier) {
+        signal(SIGUSR2, SIG_DFL);
+        close(s_signalPipe[0]);
+        close(s_signalPipe[1]);
+        s_signalPipe[0] = s_signalPipe[1] = -1;
+    }
+}
+
+QString StatsExporter::Dump() const
+{
+    return RuntimeStats::dump();
+}
+
+void StatsExporter::signalReceived()
+{
+    char buffer[16];
+    while (read(s_signalPipe[0], buffer, sizeof(buffer)) > 0) {
+    }
+
+    qCInfo(QGnomePlatform).noquote() << RuntimeStats::dump();
+}
+
+// Registers the thread's counters on its first count, and folds them into the
+// totals when the thread finishes
+class ThreadRegistration
+{
+public:
+    ThreadRegistration()
+        : m_stats(RuntimeStats::instance())
+    {
+        QMutexLocker locker(&m_stats->m_threadsMutex);
+        m_stats->m_threads.append(&m_counters);
+    }
+
+    ~ThreadRegistration()
+    {
+        QMutexLocker locker(&m_stats->m_threadsMutex);
+        for (int counter = 0; counter < RuntimeStats::CounterCount; ++counter) {
+            m_stats->m_finishedThreads[counter] += m_counters.values[counter].load(std::memory_order_relaxed);
+        }
+        m_stats->m_threads.removeOne(&m_counters);
+    }
+
+    RuntimeStats::ThreadCounters *counters()
+    {
+        return &m_counters;
+    }
+
+private:
+    RuntimeStats *m_stats;
+    RuntimeStats::ThreadCounters m_counters;
+};
+
+RuntimeStats::ThreadCounters *RuntimeStats::threadCounters()
+{
+    static thread_local ThreadRegistration registration;
+    return registration.counters();
+}
+
+RuntimeStats *RuntimeStats::instance()
+{
+    RuntimeStats *stats = s_instance.load(std::memory_order_acquire);
+    if (Q_LIKELY(stats)) {
+        return stats;
+    }
+
+    static QBasicMutex mutex;
+    QMutexLocker locker(&mutex);
+
+    stats = s_instance.load(std::memory_order_relaxed);
+    if (!stats) {
+        QCoreApplication *app = QCoreApplication::instance();
+        if (app) {
+            stats = reinterpret_cast<RuntimeStats *>(app->property(sharedStatsProperty).value<quintptr>());
+        }
+
+        // Never freed, plugins keep counting until the very end of the application
+        if (!stats) {
+            stats = new RuntimeStats();
+            if (app) {
+                app->setProperty(sharedStatsProperty, QVariant::fromValue(reinterpret_cast<quintptr>(stats)));
+            }
+        }
+
+        s_instance.store(stats, std::memory_order_release);
+    }
+
+    return stats;
+}
+
+void RuntimeStats::decorationPainted(QWindow *window, qint64 time)
+{
+    count(DecorationPaints);
+    count(DecorationPaintTime, quint64(time));
+
+    RuntimeStats *stats = instance();
+    QMutexLocker locker(&stats->m_windowsMutex);
+    WindowPaints &paints = stats->m_windows[window];
+    if (!paints.window) {
+        // Dropped with the window, dumping is optional and can't be relied on to clean up
+        paints.window = window;
+        QObject::connect(window, &QObject::destroyed, [stats, window] () {
+            QMutexLocker locker(&stats->m_windowsMutex);
+            stats->m_windows.remove(window);
+        });
+    }
+    paints.paints++;
+    paints.time += time;
+}
+
+QString RuntimeStats::dump()
+{
+    RuntimeStats *stats = instance();
+
+    quint64 totals[CounterCount];
+    {
+        QMutexLocker locker(&stats->m_threadsMutex);
+        for (int counter = 0; counter < CounterCount; ++counter) {
+            totals[counter] = stats->m_finishedThreads[counter];
+            for (const ThreadCounters *counters : qAsConst(stats->m_threads)) {
+                totals[counter] += counters->values[counter].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    QStringList lines = { QStringLiteral("QGnomePlatform statistics:") };
+    for (int counter = 0; counter < CounterCount; ++counter) {
+        lines << QStringLiteral("  %1: %2").arg(QLatin1String(counterNames[counter])).arg(totals[counter]);
+    }
+
+    QMutexLocker locker(&stats->m_windowsMutex);
+    for (const WindowPaints &paints : qAsConst(stats->m_windows)) {
+        if (paints.window) {
+            lines << QStringLiteral("  window \"%1\": %2 paints in %3 us").arg(paints.window->title()).arg(paints.paints).arg(paints.time);
+        }
+    }
+
+    return lines.join(QLatin1Char('\n'));
+}
+
+void RuntimeStats::installExporter(QObject *parent)
+{
+    // Looks the counters up on the main thread, before the settings worker counts
+    instance();
+
+    const QList<QByteArray> exporters = qgetenv("QGNOMEPLATFORM_STATS").split(',');
+    const bool onSignal = exporters.contains("signal");
+    const bool onBus = exporters.contains("dbus");
+    if (!onSignal && !onBus) {
+        return;
+    }
+
+    new StatsExporter(onSignal, onBus, parent);
+}
+
+#include "runtimestats.moc"
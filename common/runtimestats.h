@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef RUNTIME_STATS_H
+#define RUNTIME_STATS_H
+
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QString>
+#include <QVector>
+#include <QWindow>
+
+#include <atomic>
+
+// Counters of what the platform theme does while the application runs, always
+// on so a sluggish application can be checked without a profiler. Each thread
+// counts in a block of its own, counting is a plain load and store without any
+// read-modify-write on memory shared with other threads. The blocks are summed
+// up when the counters are dumped.
+//
+// QGNOMEPLATFORM_STATS makes them available on demand, "signal" logs them on
+// SIGUSR2 and "dbus" exports them on the session bus at /QGnomePlatform/Stats.
+class RuntimeStats
+{
+public:
+    enum Counter {
+        ThemeHintCalls,
+        FontCalls,
+        PaletteCalls,
+        GSettingsReads,
+        DConfReads,
+        XfconfReads,
+        PortalReads,
+        ChangesReceived,
+        ChangesApplied,
+        WidgetInvalidations,
+        DecorationPaints,
+        DecorationPaintTime, // microseconds
+        PixmapCacheHits,
+        PixmapCacheMisses,
+        DialogOpens,
+        CounterCount
+    };
+
+    static void count(Counter counter, quint64 amount = 1)
+    {
+        // Only the owning thread writes, dump() reads
+        std::atomic<quint64> &value = threadCounters()->values[counter];
+        value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    static void decorationPainted(QWindow *window, qint64 time);
+
+    static QString dump();
+
+    // Sets up the dump on demand, for as long as parent lives
+    static void installExporter(QObject *parent);
+
+private:
+    friend class ThreadRegistration;
+
+    struct ThreadCounters {
+        std::atomic<quint64> values[CounterCount] {};
+    };
+
+    struct WindowPaints {
+        QPointer<QWindow> window;
+        quint64 paints = 0;
+        qint64 time = 0;
+    };
+
+    static RuntimeStats *instance();
+    static ThreadCounters *threadCounters();
+
+    // Counting threads, and what the ones which finished counted
+    QMutex m_threadsMutex;
+    QVector<ThreadCounters *> m_threads;
+    quint64 m_finishedThreads[CounterCount] {};
+
+    QMutex m_windowsMutex;
+    QHash<const QWindow *, WindowPaints> m_windows;
+};
+
+#endif // RUNTIME_STATS_H
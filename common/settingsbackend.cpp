@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "settingsbackend.h"
+#include "gsettingsbackend.h"
+#include "portalsettingsbackend.h"
+#include "xfconfsettingsbackend.h"
+
+#include <QLoggingCategory>
+#include <QStandardPaths>
+
+Q_DECLARE_LOGGING_CATEGORY(QGnomePlatform)
+
+static inline bool checkUsePortalSupport()
+{
+    return !QStandardPaths::locate(QStandardPaths::RuntimeLocation, QStringLiteral("flatpak-info")).isEmpty() || qEnvironmentVariableIsSet("SNAP");
+}
+
+static SettingsBackend *desktopBackend(QObject *parent)
+{
+    QByteArray desktop = qgetenv("QGNOMEPLATFORM_SETTINGS_BACKEND").toLower();
+    if (desktop.isEmpty()) {
+        desktop = qgetenv("XDG_CURRENT_DESKTOP").toLower();
+    }
+
+    // XDG_CURRENT_DESKTOP is a list, the first desktop we know wins
+    for (const QByteArray &name : desktop.split(':')) {
+        if (name == "gnome" || name == "unity" || name == "pantheon" || name == "budgie") {
+            return GSettingsBackend::gnome(parent);
+        } else if (name == "x-cinnamon" || name == "cinnamon") {
+            return GSettingsBackend::cinnamon(parent);
+        } else if (name == "mate") {
+            return GSettingsBackend::mate(parent);
+        } else if (name == "xfce") {
+            return new XfconfSettingsBackend(parent);
+        }
+    }
+
+    return GSettingsBackend::gnome(parent);
+}
+
+SettingsBackend::SettingsBackend(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SettingsBackend *SettingsBackend::create(QObject *parent)
+{
+    SettingsBackend *backend = desktopBackend(parent);
+
+    if (checkUsePortalSupport()) {
+        backend = new PortalSettingsBackend(backend, parent);
+    }
+
+    qCDebug(QGnomePlatform) << "Settings backend: " << backend->name();
+    return backend;
+}
+
+bool SettingsBackend::isCacheable() const
+{
+    return true;
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef SETTINGS_BACKEND_H
+#define SETTINGS_BACKEND_H
+
+#include <QObject>
+#include <QVariant>
+
+#include "gnomehintssettings.h"
+
+// Where the desktop keeps the settings we read. Each desktop maps the keys to its
+// own configuration once, when the backend is created, so reading them later
+// doesn't involve any lookups.
+class SettingsBackend : public QObject
+{
+    Q_OBJECT
+public:
+    typedef GnomeHintsSettings::SettingKey SettingKey;
+
+    // Picks the backend for the current session from XDG_CURRENT_DESKTOP, or from
+    // QGNOMEPLATFORM_SETTINGS_BACKEND when set. Inside a sandbox the settings
+    // portal is put in front of it.
+    static SettingsBackend *create(QObject *parent = nullptr);
+
+    explicit SettingsBackend(QObject *parent = nullptr);
+
+    virtual const char *name() const = 0;
+
+    // Current value of every key the backend provides, all in one go. Keys the
+    // desktop doesn't have are left invalid.
+    virtual void readAll(QVariant *values) = 0;
+
+    // Starts reporting changes. Values are what the caller already has, from readAll()
+    // or from the settings snapshot, whatever the desktop holds different by now is
+    // reported right away. Nothing is watched before, startup doesn't pay for it.
+    virtual void watch(const QVariant *values) = 0;
+
+    // Whether the values are complete once readAll() returns, otherwise they can't
+    // be stored in the settings snapshot
+    virtual bool isCacheable() const;
+
+Q_SIGNALS:
+    void valueChanged(GnomeHintsSettings::SettingKey key, const QVariant &value);
+};
+
+#endif // SETTINGS_BACKEND_H
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef THEME_HINT_TABLE_H
+#define THEME_HINT_TABLE_H
+
+#include "atomicsnapshot.h"
+#include "gnomehintssettings.h"
+#include "runtimestats.h"
+
+#include <qpa/qplatformtheme.h>
+
+// The theme hints resolved from the settings, as QGnomePlatformTheme::themeHint()
+// looks them up. Replaced as a whole on changes, it's read from other threads too.
+//
+// Hints the settings don't provide are left to QPlatformTheme when they're asked
+// for, it answers some of them from the platform integration.
+class ThemeHintTable
+{
+public:
+    inline QVariant themeHint(QPlatformTheme::ThemeHint hint, const QPlatformTheme *theme) const
+    {
+        RuntimeStats::count(RuntimeStats::ThemeHintCalls);
+
+        if (uint(hint) < GnomeHintsSettings::ThemeHintCount) {
+            const QVariant &value = m_values.load()->values[hint];
+            if (value.isValid()) {
+                return value;
+            }
+        }
+
+        return theme->QPlatformTheme::themeHint(hint);
+    }
+
+    inline void update(const QVariant *hints)
+    {
+        Values *values = new Values;
+        for (int hint = 0; hint < GnomeHintsSettings::ThemeHintCount; ++hint) {
+            values->values[hint] = hints[hint];
+        }
+
+        m_values.publish(values);
+    }
+
+private:
+    struct Values {
+        QVariant values[GnomeHintsSettings::ThemeHintCount];
+    };
+    AtomicSnapshot<Values> m_values;
+};
+
+#endif // THEME_HINT_TABLE_H
@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "xdgdataindex.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+static QSet<QString> subdirectories(const QString &path)
+{
+    QSet<QString> names;
+    for (const QString &name : QDir(path).entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+        names.insert(name);
+    }
+    return names;
+}
+
+XdgDataIndex::XdgDataIndex(QObject *parent)
+    : QObject(parent)
+{
+    // Installing a theme touches the directories many times, rebuild once it settles
+    m_rebuildTimer.setSingleShot(true);
+    m_rebuildTimer.setInterval(500);
+    connect(&m_rebuildTimer, &QTimer::timeout, this, &XdgDataIndex::rebuild);
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, &m_rebuildTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+}
+
+QStringList XdgDataIndex::iconThemePaths()
+{
+    ensureBuilt();
+    return m_iconThemePaths;
+}
+
+QString XdgDataIndex::kvantumThemeForGtkTheme(const QString &gtkTheme)
+{
+    if (gtkTheme.isEmpty()) {
+        // No Gtk theme? Then can't match to Kvantum!
+        return QString();
+    }
+
+    auto it = m_kvantumThemes.constFind(gtkTheme);
+    if (it != m_kvantumThemes.constEnd()) {
+        return it.value();
+    }
+
+    // Until the index is built, which startup doesn't wait for, the few candidate files
+    // are looked up directly in every data directory
+    QVector<DataDir> dataDirs = m_dataDirs;
+    if (!m_built) {
+        for (const QString &path : QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation)) {
+            DataDir dataDir;
+            dataDir.path = path;
+            dataDirs << dataDir;
+        }
+    }
+
+    QString kvantumTheme;
+
+    // Look for a matching KVantum config file in the theme's folder
+    for (const DataDir &dataDir : dataDirs) {
+        if ((!m_built || dataDir.themes.contains(gtkTheme)) &&
+            QFile::exists(QStringLiteral("%1/themes/%2/Kvantum/%3.kvconfig").arg(dataDir.path).arg(gtkTheme).arg(gtkTheme))) {
+            kvantumTheme = gtkTheme;
+            break;
+        }
+    }
+
+    if (kvantumTheme.isEmpty()) {
+        // No config found in theme folder, look for a Kv<Theme> as shipped as part of Kvantum itself
+        // (Kvantum ships KvAdapta, KvAmbiance, KvArc, etc.
+        QStringList names { QStringLiteral("Kv") + gtkTheme };
+
+        // Convert Ark-Dark to ArcDark to look for KvArcDark
+        if (gtkTheme.indexOf(QLatin1Char('-')) != -1) {
+            names.append(QStringLiteral("Kv") + QString(gtkTheme).remove(QLatin1Char('-')));
+        }
+
+        for (const QString &name : names) {
+            for (const DataDir &dataDir : dataDirs) {
+                if ((!m_built || dataDir.kvantumThemes.contains(name)) &&
+                    QFile::exists(QStringLiteral("%1/Kvantum/%2/%3.kvconfig").arg(dataDir.path).arg(name).arg(name))) {
+                    kvantumTheme = name;
+                    break;
+                }
+            }
+
+            if (!kvantumTheme.isEmpty()) {
+                break;
+            }
+        }
+    }
+
+    m_kvantumThemes.insert(gtkTheme, kvantumTheme);
+    return kvantumTheme;
+}
+
+QStringList XdgDataIndex::iconThemeCandidatePaths()
+{
+    QStringList paths = { QDir::homePath() + QStringLiteral("/.icons") };
+
+    QString xdgDirString = QFile::decodeName(qgetenv("XDG_DATA_DIRS"));
+    if (xdgDirString.isEmpty()) {
+        xdgDirString = QStringLiteral("/usr/local/share:/usr/share");
+    }
+
+    for (const QString &xdgDir : xdgDirString.split(QLatin1Char(':'))) {
+        paths << QDir::cleanPath(xdgDir + QStringLiteral("/icons"));
+    }
+
+    return paths;
+}
+
+void XdgDataIndex::rebuild()
+{
+    const QStringList oldIconThemePaths = m_iconThemePaths;
+    const QVector<DataDir> oldDataDirs = m_dataDirs;
+
+    build();
+
+    if (m_iconThemePaths != oldIconThemePaths || !(m_dataDirs == oldDataDirs)) {
+        Q_EMIT changed();
+    }
+}
+
+void XdgDataIndex::ensureBuilt()
+{
+    if (!m_built) {
+        build();
+    }
+}
+
+void XdgDataIndex::build()
+{
+    m_built = true;
+    m_iconThemePaths.clear();
+    m_dataDirs.clear();
+    m_kvantumThemes.clear();
+
+    const QStringList watched = m_watcher.directories();
+    if (!watched.isEmpty()) {
+        m_watcher.removePaths(watched);
+    }
+
+    for (const QString &path : iconThemeCandidatePaths()) {
+        if (QFileInfo(path).isDir()) {
+            m_iconThemePaths << path;
+            watch(path);
+        }
+    }
+
+    // Only directories which exist are watched, a themes or Kvantum directory created
+    // later in a data directory is picked up by the next process
+    for (const QString &path : QStandardPaths::standardLocations(QStandardPaths::GenericDataLocation)) {
+        DataDir dataDir;
+        dataDir.path = path;
+        dataDir.themes = subdirectories(path + QStringLiteral("/themes"));
+        dataDir.kvantumThemes = subdirectories(path + QStringLiteral("/Kvantum"));
+        m_dataDirs << dataDir;
+
+        watch(path + QStringLiteral("/themes"));
+        watch(path + QStringLiteral("/Kvantum"));
+    }
+}
+
+void XdgDataIndex::watch(const QString &path)
+{
+    if (QFileInfo(path).isDir() && !m_watcher.directories().contains(path)) {
+        m_watcher.addPath(path);
+    }
+}
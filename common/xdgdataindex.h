@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef XDG_DATA_INDEX_H
+#define XDG_DATA_INDEX_H
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+// Index of what the XDG data directories provide for us: icon theme roots and
+// Kvantum configurations. It's built on first use of the icon theme paths with one
+// directory listing per location and rebuilt only when one of the watched
+// directories changes. Kvantum lookups before that check the few files directly.
+class XdgDataIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit XdgDataIndex(QObject *parent = nullptr);
+
+    QStringList iconThemePaths();
+
+    // Where icon themes may be, without checking which of the directories exist.
+    // iconThemePaths() are the ones of them which do.
+    static QStringList iconThemeCandidatePaths();
+    QString kvantumThemeForGtkTheme(const QString &gtkTheme);
+
+Q_SIGNALS:
+    // Emitted when a rebuild found different icon roots or Kvantum themes
+    void changed();
+
+private Q_SLOTS:
+    void rebuild();
+
+private:
+    struct DataDir {
+        QString path;
+        QSet<QString> themes;
+        QSet<QString> kvantumThemes;
+
+        bool operator==(const DataDir &other) const
+        {
+            return path == other.path && themes == other.themes && kvantumThemes == other.kvantumThemes;
+        }
+    };
+
+    void ensureBuilt();
+    void build();
+    void watch(const QString &path);
+
+    bool m_built = false;
+    QStringList m_iconThemePaths;
+    QVector<DataDir> m_dataDirs;
+    QHash<QString, QString> m_kvantumThemes;
+    QFileSystemWatcher m_watcher;
+    QTimer m_rebuildTimer;
+};
+
+#endif // XDG_DATA_INDEX_H
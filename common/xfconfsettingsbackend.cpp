@@ -0,0 +1,256 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "xfconfsettingsbackend.h"
+#include "phasetrace.h"
+#include "runtimestats.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCallWatcher>
+#include <QDBusReply>
+#include <QLoggingCategory>
+#include <QStringList>
+
+Q_DECLARE_LOGGING_CATEGORY(QGnomePlatform)
+
+static const char *xfconfService = "org.xfce.Xfconf";
+static const char *xfconfPath = "/org/xfce/Xfconf";
+static const char *xfconfInterface = "org.xfce.Xfconf";
+
+static const struct {
+    GnomeHintsSettings::SettingKey key;
+    const char *channel;
+    const char *property;
+} xfconfKeys[] = {
+    { GnomeHintsSettings::GtkThemeKey, "xsettings", "/Net/ThemeName" },
+    { GnomeHintsSettings::IconThemeKey, "xsettings", "/Net/IconThemeName" },
+    { GnomeHintsSettings::CursorBlinkKey, "xsettings", "/Net/CursorBlink" },
+    { GnomeHintsSettings::CursorBlinkTimeKey, "xsettings", "/Net/CursorBlinkTime" },
+    { GnomeHintsSettings::CursorBlinkTimeoutKey, "xsettings", "/Gtk/CursorBlinkTimeout" },
+    { GnomeHintsSettings::CursorSizeKey, "xsettings", "/Gtk/CursorThemeSize" },
+    { GnomeHintsSettings::FontNameKey, "xsettings", "/Gtk/FontName" },
+    { GnomeHintsSettings::MonospaceFontNameKey, "xsettings", "/Gtk/MonospaceFontName" },
+    { GnomeHintsSettings::FontAntialiasingKey, "xsettings", "/Xft/Antialias" },
+    { GnomeHintsSettings::FontHintingKey, "xsettings", "/Xft/HintStyle" },
+    { GnomeHintsSettings::FontRgbaOrderKey, "xsettings", "/Xft/RGBA" },
+    { GnomeHintsSettings::EnableAnimationsKey, "xsettings", "/Gtk/EnableAnimations" },
+    { GnomeHintsSettings::TitlebarFontKey, "xfwm4", "/general/title_font" },
+    { GnomeHintsSettings::ButtonLayoutKey, "xfwm4", "/general/button_layout" },
+    { GnomeHintsSettings::DoubleClickTimeKey, "xsettings", "/Net/DoubleClickTime" },
+    { GnomeHintsSettings::DragThresholdKey, "xsettings", "/Net/DndDragThreshold" }
+};
+
+// The xfwm4 layout is a string of button letters with | standing for the title,
+// like "O|HMC". GNOME lists the buttons on each side of a colon instead.
+static QString gnomeButtonLayout(const QString &xfwmLayout)
+{
+    QStringList sides[2];
+    int side = 0;
+
+    for (const QChar c : xfwmLayout) {
+        switch (c.toLatin1()) {
+        case '|':
+            side = 1;
+            break;
+        case 'O':
+            sides[side] << QStringLiteral("menu");
+            break;
+        case 'H':
+            sides[side] << QStringLiteral("minimize");
+            break;
+        case 'M':
+            sides[side] << QStringLiteral("maximize");
+            break;
+        case 'C':
+            sides[side] << QStringLiteral("close");
+            break;
+        default:
+            // Shade and stick have no GNOME counterpart
+            break;
+        }
+    }
+
+    return sides[0].join(QLatin1Char(',')) + QLatin1Char(':') + sides[1].join(QLatin1Char(','));
+}
+
+static QStringList xfconfChannels()
+{
+    return { QStringLiteral("xsettings"), QStringLiteral("xfwm4") };
+}
+
+XfconfSettingsBackend::XfconfSettingsBackend(QObject *parent)
+    : SettingsBackend(parent)
+{
+    // Both channels are asked for right away, like the portal does. The replies arrive
+    // while the rest of the platform theme is set up, readAll() only waits for what's
+    // still missing then.
+    requestProperties();
+}
+
+const char *XfconfSettingsBackend::name() const
+{
+    return "xfce";
+}
+
+void XfconfSettingsBackend::readAll(QVariant *values)
+{
+    PhaseTraceScope trace("XfconfSettingsBackend::readAll");
+
+    if (m_pendingReads.isEmpty()) {
+        requestProperties();
+    }
+
+    const QStringList channels = xfconfChannels();
+    for (int i = 0; i < channels.count(); ++i) {
+        QDBusPendingCall &pendingRead = m_pendingReads[i];
+        pendingRead.waitForFinished();
+        readProperties(channels.at(i), pendingRead.reply(), values);
+    }
+    m_pendingReads.clear();
+}
+
+void XfconfSettingsBackend::watch(const QVariant *values)
+{
+    if (m_watching) {
+        return;
+    }
+    m_watching = true;
+
+    for (int key = 0; key < GnomeHintsSettings::SettingKeyCount; ++key) {
+        m_values[key] = values[key];
+    }
+
+    // Only the channels we read from, xfconfd sends every property change otherwise
+    for (const QString &channel : xfconfChannels()) {
+        QDBusConnection::sessionBus().connect(QLatin1String(xfconfService), QLatin1String(xfconfPath), QLatin1String(xfconfInterface),
+                                              QStringLiteral("PropertyChanged"), { channel }, QStringLiteral("ssv"),
+                                              this, SLOT(propertyChanged(QString,QString,QDBusVariant)));
+    }
+
+    // Pick up whatever changed since the values were read, without waiting for it.
+    // With the values of the settings snapshot, the reads made on construction do.
+    if (m_pendingReads.isEmpty()) {
+        requestProperties();
+    }
+
+    const QStringList channels = xfconfChannels();
+    for (int i = 0; i < channels.count(); ++i) {
+        const QString channel = channels.at(i);
+        QDBusPendingCallWatcher *watcher = new QDBusPendingCallWatcher(m_pendingReads.at(i), this);
+        connect(watcher, &QDBusPendingCallWatcher::finished, this, [this, channel] (QDBusPendingCallWatcher *watcher) {
+            watcher->deleteLater();
+
+            QVariant values[GnomeHintsSettings::SettingKeyCount];
+            readProperties(channel, watcher->reply(), values);
+            for (int key = 0; key < GnomeHintsSettings::SettingKeyCount; ++key) {
+                if (values[key].isValid() && values[key] != m_values[key]) {
+                    m_values[key] = values[key];
+                    Q_EMIT valueChanged(static_cast<SettingKey>(key), values[key]);
+                }
+            }
+        });
+    }
+    m_pendingReads.clear();
+}
+
+void XfconfSettingsBackend::propertyChanged(const QString &channel, const QString &property, const QDBusVariant &value)
+{
+    const SettingKey key = keyForProperty(channel, property);
+    if (key != GnomeHintsSettings::SettingKeyCount) {
+        m_values[key] = toSettingValue(key, value.variant());
+        Q_EMIT valueChanged(key, m_values[key]);
+    }
+}
+
+void XfconfSettingsBackend::requestProperties()
+{
+    for (const QString &channel : xfconfChannels()) {
+        RuntimeStats::count(RuntimeStats::XfconfReads);
+        m_pendingReads << QDBusConnection::sessionBus().asyncCall(getAllProperties(channel));
+    }
+}
+
+QDBusMessage XfconfSettingsBackend::getAllProperties(const QString &channel)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall(QLatin1String(xfconfService), QLatin1String(xfconfPath),
+                                                          QLatin1String(xfconfInterface), QStringLiteral("GetAllProperties"));
+    message << channel << QStringLiteral("/");
+    return message;
+}
+
+void XfconfSettingsBackend::readProperties(const QString &channel, const QDBusMessage &reply, QVariant *values)
+{
+    const QDBusReply<QVariantMap> properties = reply;
+    if (!properties.isValid()) {
+        qCWarning(QGnomePlatform) << "Failed to read xfconf channel " << channel << ": " << properties.error().message();
+        return;
+    }
+
+    const QVariantMap map = properties.value();
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+        const SettingKey key = keyForProperty(channel, it.key());
+        if (key != GnomeHintsSettings::SettingKeyCount) {
+            values[key] = toSettingValue(key, it.value());
+        }
+    }
+}
+
+GnomeHintsSettings::SettingKey XfconfSettingsBackend::keyForProperty(const QString &channel, const QString &property)
+{
+    for (const auto &mapping : xfconfKeys) {
+        if (property == QLatin1String(mapping.property) && channel == QLatin1String(mapping.channel)) {
+            return mapping.key;
+        }
+    }
+
+    return GnomeHintsSettings::SettingKeyCount;
+}
+
+QVariant XfconfSettingsBackend::toSettingValue(SettingKey key, const QVariant &value)
+{
+    switch (key) {
+    case GnomeHintsSettings::ButtonLayoutKey:
+        return gnomeButtonLayout(value.toString());
+    case GnomeHintsSettings::FontAntialiasingKey:
+        // Xft has no grayscale mode, the subpixel order being "none" means that
+        switch (value.toInt()) {
+        case 0:
+            return QStringLiteral("none");
+        case 1:
+            return QStringLiteral("rgba");
+        default:
+            return QVariant();
+        }
+    case GnomeHintsSettings::FontHintingKey:
+        // "hintslight" and so on
+        return value.toString().remove(QStringLiteral("hint"));
+    case GnomeHintsSettings::CursorBlinkKey:
+    case GnomeHintsSettings::EnableAnimationsKey:
+        return value.toBool();
+    case GnomeHintsSettings::CursorBlinkTimeKey:
+    case GnomeHintsSettings::CursorBlinkTimeoutKey:
+    case GnomeHintsSettings::CursorSizeKey:
+    case GnomeHintsSettings::DoubleClickTimeKey:
+    case GnomeHintsSettings::DragThresholdKey:
+        return value.toInt();
+    default:
+        return value.toString();
+    }
+}
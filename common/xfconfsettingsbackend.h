@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#ifndef XFCONF_SETTINGS_BACKEND_H
+#define XFCONF_SETTINGS_BACKEND_H
+
+#include "settingsbackend.h"
+
+#include <QDBusMessage>
+#include <QDBusPendingCall>
+#include <QDBusVariant>
+#include <QVector>
+
+// Xfce settings, read from the xsettings and xfwm4 channels of the xfconf daemon
+// on the session bus. Values are converted to what the GNOME keys would hold.
+class XfconfSettingsBackend : public SettingsBackend
+{
+    Q_OBJECT
+public:
+    explicit XfconfSettingsBackend(QObject *parent = nullptr);
+
+    const char *name() const override;
+    void readAll(QVariant *values) override;
+    void watch(const QVariant *values) override;
+
+    // SettingKeyCount for properties we don't read
+    static SettingKey keyForProperty(const QString &channel, const QString &property);
+    // What the GNOME key would hold for the xfconf value
+    static QVariant toSettingValue(SettingKey key, const QVariant &value);
+
+private Q_SLOTS:
+    void propertyChanged(const QString &channel, const QString &property, const QDBusVariant &value);
+
+private:
+    void requestProperties();
+
+    static QDBusMessage getAllProperties(const QString &channel);
+    static void readProperties(const QString &channel, const QDBusMessage &reply, QVariant *values);
+
+    // Asked for on construction, consumed by readAll() or watch()
+    QVector<QDBusPendingCall> m_pendingReads;
+    QVariant m_values[GnomeHintsSettings::SettingKeyCount];
+    bool m_watching = false;
+};
+
+#endif // XFCONF_SETTINGS_BACKEND_H
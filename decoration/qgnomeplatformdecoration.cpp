@@ -41,6 +41,11 @@
 #include "qgnomeplatformdecoration.h"
 
 #include "gnomehintssettings.h"
+#include "gtkpalette.h"
+#include "phasetrace.h"
+#include "runtimestats.h"
+
+#include <QtCore/QElapsedTimer>
 
 #include <QtGui/QColor>
 #include <QtGui/QCursor>
@@ -59,50 +64,32 @@
 #define BUTTON_WIDTH 26
 #define BUTTONS_RIGHT_MARGIN 6
 
-// Copied from adwaita-qt
-static QColor transparentize(const QColor &color, qreal amount = 0.1)
-{
-    qreal h, s, l, a;
-    color.getHslF(&h, &s, &l, &a);
-
-    qreal alpha = a - amount;
-    if (alpha < 0)
-        alpha = 0;
-    return QColor::fromHslF(h, s, l, alpha);
-}
-
-static QColor darken(const QColor &color, qreal amount = 0.1)
-{
-    qreal h, s, l, a;
-    color.getHslF(&h, &s, &l, &a);
-
-    qreal lightness = l - amount;
-    if (lightness < 0)
-        lightness = 0;
-
-    return QColor::fromHslF(h, s, lightness, a);
-}
-
-static QColor desaturate(const QColor &color, qreal amount = 0.1)
-{
-    qreal h, s, l, a;
-    color.getHslF(&h, &s, &l, &a);
-
-    qreal saturation = s - amount;
-    if (saturation < 0)
-        saturation = 0;
-    return QColor::fromHslF(h, saturation, l, a);
-}
-
 QGnomePlatformDecoration::QGnomePlatformDecoration()
     : m_closeButtonHovered(false)
     , m_maximizeButtonHovered(false)
     , m_minimizeButtonHovered(false)
-    , m_hints(new GnomeHintsSettings)
+    , m_hints(GnomeHintsSettings::acquire())
 {
     initializeButtonPixmaps();
     initializeColors();
 
+    // Repaint for the settings the titlebar shows, colors and button icons are picked up
+    // when painting
+    const GnomeHintsSettings::SettingKey keys[] = { GnomeHintsSettings::TitlebarFontKey, GnomeHintsSettings::TextScalingFactorKey,
+                                                    GnomeHintsSettings::GtkThemeKey, GnomeHintsSettings::IconThemeKey };
+    for (GnomeHintsSettings::SettingKey key : keys) {
+        m_hints->subscribe(key, this, [this] (const QVariant &, const QVariant &) {
+            requestRepaint();
+        });
+    }
+
+    // The button layout may only be loaded after the first frame
+    connect(m_hints, &GnomeHintsSettings::settingsChanged, this, [this] (GnomeHintsSettings::Changes changes) {
+        if (changes & GnomeHintsSettings::TitlebarChange) {
+            requestRepaint();
+        }
+    });
+
     m_lastButtonClick = QDateTime::currentDateTime();
 
     QTextOption option(Qt::AlignHCenter | Qt::AlignVCenter);
@@ -112,7 +99,15 @@ QGnomePlatformDecoration::QGnomePlatformDecoration()
 
 QGnomePlatformDecoration::~QGnomePlatformDecoration()
 {
-    delete m_hints;
+    GnomeHintsSettings::release(m_hints);
+}
+
+void QGnomePlatformDecoration::requestRepaint()
+{
+    update();
+    if (waylandWindow()) {
+        waylandWindow()->requestUpdate();
+    }
 }
 
 void QGnomePlatformDecoration::initializeButtonPixmaps()
@@ -121,7 +116,16 @@ void QGnomePlatformDecoration::initializeButtonPixmaps()
     const bool isAdwaitaIconTheme = iconTheme.toLower() == QStringLiteral("adwaita");
     const bool isDarkVariant = m_hints->gtkThemeDarkVariant();
 
-    QIcon::setThemeName(m_hints->hint(QPlatformTheme::SystemIconThemeName).toString());
+    // Rendered again only when the icon theme or the variant changed
+    if (!m_buttonPixmaps.isEmpty() && iconTheme == m_buttonPixmapsIconTheme && isDarkVariant == m_buttonPixmapsDarkVariant) {
+        RuntimeStats::count(RuntimeStats::PixmapCacheHits);
+        return;
+    }
+    RuntimeStats::count(RuntimeStats::PixmapCacheMisses);
+    m_buttonPixmapsIconTheme = iconTheme;
+    m_buttonPixmapsDarkVariant = isDarkVariant;
+
+    QIcon::setThemeName(iconTheme);
 
     QPixmap closeIcon = QIcon::fromTheme(QStringLiteral("window-close-symbolic"), QIcon::fromTheme(QStringLiteral("window-close"))).pixmap(QSize(16, 16));
     QPixmap maximizeIcon = QIcon::fromTheme(QStringLiteral("window-maximize-symbolic"), QIcon::fromTheme(QStringLiteral("window-maximize"))).pixmap(QSize(16, 16));
@@ -136,14 +140,27 @@ void QGnomePlatformDecoration::initializeButtonPixmaps()
 
 void QGnomePlatformDecoration::initializeColors()
 {
-    const bool darkVariant = m_hints->gtkThemeDarkVariant();
-    m_foregroundColor         = darkVariant ? QColor("#eeeeec") : QColor("#2e3436"); // Adwaita fg_color
-    m_backgroundColorStart    = darkVariant ? QColor("#262626") : QColor("#dad6d2"); // Adwaita GtkHeaderBar color
-    m_backgroundColorEnd      = darkVariant ? QColor("#2b2b2b") : QColor("#e1dedb"); // Adwaita GtkHeaderBar color
-    m_foregroundInactiveColor = darkVariant ? QColor("#919190") : QColor("#929595");
-    m_backgroundInactiveColor = darkVariant ? QColor("#353535") : QColor("#f6f5f4");
-    m_borderColor             = darkVariant ? transparentize(QColor("#1b1b1b"), 0.1) : transparentize(QColor("black"), 0.77);
-    m_borderInactiveColor     = darkVariant ? transparentize(QColor("#1b1b1b"), 0.1) : transparentize(QColor("black"), 0.82);
+    // Same colors the Gtk theme uses for its own window decorations
+    const GnomeHintsSettings::Snapshot *snapshot = m_hints->snapshot();
+    const GtkPalette *palette = snapshot->gtkPalette;
+    m_colorsGeneration = snapshot->generation;
+    m_flat = snapshot->lowBandwidth;
+    if (!palette) {
+        return;
+    }
+
+    const bool darkVariant = palette->isDarkVariant();
+    m_foregroundColor         = palette->color(QStringLiteral("wm_title"));
+    m_backgroundColorStart    = palette->color(QStringLiteral("wm_bg_b"));
+    m_backgroundColorEnd      = palette->color(QStringLiteral("wm_bg_a"));
+    m_foregroundInactiveColor = palette->color(QStringLiteral("wm_unfocused_title"));
+    m_backgroundInactiveColor = palette->color(QStringLiteral("theme_unfocused_bg_color"));
+    m_borderColor             = darkVariant ? GtkPalette::transparentize(palette->color(QStringLiteral("borders")), 0.1) : GtkPalette::transparentize(QColor("black"), 0.77);
+    m_borderInactiveColor     = darkVariant ? GtkPalette::transparentize(palette->color(QStringLiteral("unfocused_borders")), 0.1) : GtkPalette::transparentize(QColor("black"), 0.82);
+
+    // From adwaita-qt
+    m_buttonHoverColor        = palette->color(QStringLiteral("theme_bg_color"));
+    m_buttonHoverBorderColor  = GtkPalette::darken(m_buttonHoverColor, darkVariant ? 0.1 : 0.18);
 }
 
 QPixmap QGnomePlatformDecoration::pixmapDarkVariant(const QPixmap &pixmap)
@@ -196,15 +213,32 @@ QMargins QGnomePlatformDecoration::margins() const
 
 void QGnomePlatformDecoration::paint(QPaintDevice *device)
 {
+    // Only the first frame of a window is part of its startup
+    PhaseTraceScope trace(m_painted ? nullptr : "QGnomePlatformDecoration first paint");
+    m_painted = true;
+
+    QElapsedTimer paintTimer;
+    paintTimer.start();
+
     bool active = window()->handle()->isActive();
     QRect surfaceRect(QPoint(), window()->frameGeometry().size());
 
+    if (m_hints->generation() != m_colorsGeneration) {
+        initializeColors();
+        initializeButtonPixmaps();
+    }
+
+    // Solid fills with square corners compress well in remote sessions
+    const bool squareCorners = m_flat || (window()->windowStates() & Qt::WindowMaximized);
+
     QPainter p(device);
-    p.setRenderHint(QPainter::Antialiasing);
+    if (!m_flat) {
+        p.setRenderHint(QPainter::Antialiasing);
+    }
 
     // Title bar (border)
     QPainterPath borderRect;
-    if ((window()->windowStates() & Qt::WindowMaximized))
+    if (squareCorners)
         borderRect.addRect(0, 0, surfaceRect.width(), margins().top() + 8);
     else
         borderRect.addRoundedRect(0, 0, surfaceRect.width(), margins().top() + 8, 10, 10);
@@ -213,15 +247,19 @@ void QGnomePlatformDecoration::paint(QPaintDevice *device)
 
     // Title bar
     QPainterPath roundedRect;
-    if ((window()->windowStates() & Qt::WindowMaximized))
+    if (squareCorners)
         roundedRect.addRect(1, 1, surfaceRect.width() - margins().left() - margins().right(), margins().top() + 8);
     else
         roundedRect.addRoundedRect(1, 1, surfaceRect.width() - margins().left() - margins().right(), margins().top() + 8, 8, 8);
 
-    QLinearGradient gradient(margins().left(), margins().top() + 6, margins().left(), 1);
-    gradient.setColorAt(0, active ? m_backgroundColorStart : m_backgroundInactiveColor);
-    gradient.setColorAt(1, active ? m_backgroundColorEnd : m_backgroundInactiveColor);
-    p.fillPath(roundedRect.simplified(), gradient);
+    if (m_flat) {
+        p.fillPath(roundedRect.simplified(), active ? m_backgroundColorEnd : m_backgroundInactiveColor);
+    } else {
+        QLinearGradient gradient(margins().left(), margins().top() + 6, margins().left(), 1);
+        gradient.setColorAt(0, active ? m_backgroundColorStart : m_backgroundInactiveColor);
+        gradient.setColorAt(1, active ? m_backgroundColorEnd : m_backgroundInactiveColor);
+        p.fillPath(roundedRect.simplified(), gradient);
+    }
 
     QPainterPath borderPath;
     borderPath.addRect(0, margins().top(), margins().left(), surfaceRect.height() - margins().top());
@@ -234,9 +272,12 @@ void QGnomePlatformDecoration::paint(QPaintDevice *device)
     // Window title
     QString windowTitleText = window()->title();
     if (!windowTitleText.isEmpty()) {
-        if (m_windowTitle.text() != windowTitleText) {
+        // Laid out with the same, already scaled, font it's drawn with to center it correctly
+        const QFont *titleFont = m_hints->font(QPlatformTheme::TitleBarFont);
+        if (m_windowTitle.text() != windowTitleText || m_windowTitleFont != titleFont) {
             m_windowTitle.setText(windowTitleText);
-            m_windowTitle.prepare();
+            m_windowTitle.prepare(QTransform(), *titleFont);
+            m_windowTitleFont = titleFont;
         }
 
         QRect titleBar = top;
@@ -254,12 +295,7 @@ void QGnomePlatformDecoration::paint(QPaintDevice *device)
         QSizeF size = m_windowTitle.size();
         int dx = (top.width() - size.width()) /2;
         int dy = (top.height()- size.height()) /2;
-        QFont font;
-        const QFont *themeFont = m_hints->font(QPlatformTheme::TitleBarFont);
-        font.setPointSizeF(themeFont->pointSizeF());
-        font.setFamily(themeFont->family());
-        font.setBold(themeFont->bold());
-        p.setFont(font);
+        p.setFont(*titleFont);
         QPoint windowTitlePoint(top.topLeft().x() + dx,
                  top.topLeft().y() + dy);
         p.drawStaticText(windowTitlePoint, m_windowTitle);
@@ -268,19 +304,8 @@ void QGnomePlatformDecoration::paint(QPaintDevice *device)
 
     QRectF rect;
 
-    // From adwaita-qt
-    QColor windowColor;
-    QColor buttonHoverBorderColor;
-    // QColor buttonHoverFrameColor;
-    if (m_hints->gtkThemeDarkVariant()) {
-        windowColor = darken(desaturate(QColor("#3d3846"), 1.0), 0.04);
-        buttonHoverBorderColor = darken(windowColor, 0.1);
-        // buttonHoverFrameColor = darken(windowColor, 0.01);
-    } else {
-        windowColor = QColor("#f6f5f4");
-        buttonHoverBorderColor = darken(windowColor, 0.18);
-        // buttonHoverFrameColor = darken(windowColor, 0.04);
-    }
+    const QColor &windowColor = m_buttonHoverColor;
+    const QColor &buttonHoverBorderColor = m_buttonHoverBorderColor;
 
     // Close button
     p.save();
@@ -341,6 +366,9 @@ void QGnomePlatformDecoration::paint(QPaintDevice *device)
         p.drawPixmap(QPoint(rect.x() + 5, rect.y() + 5), m_buttonPixmaps[Button::Minimize]);
         p.restore();
     }
+
+    p.end();
+    RuntimeStats::decorationPainted(window(), paintTimer.nsecsElapsed() / 1000);
 }
 
 bool QGnomePlatformDecoration::clickButton(Qt::MouseButtons b, Button btn)
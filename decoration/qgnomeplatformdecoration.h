@@ -53,6 +53,7 @@ protected:
 private:
     void initializeButtonPixmaps();
     void initializeColors();
+    void requestRepaint();
     QPixmap pixmapDarkVariant(const QPixmap &pixmap);
 
     void processMouseTop(QWaylandInputDevice *inputDevice, const QPointF &local, Qt::MouseButtons b,Qt::KeyboardModifiers mods);
@@ -74,9 +75,16 @@ private:
     QColor m_borderInactiveColor;
     QColor m_foregroundColor;
     QColor m_foregroundInactiveColor;
+    QColor m_buttonHoverColor;
+    QColor m_buttonHoverBorderColor;
+    quint64 m_colorsGeneration = 0;
+    bool m_flat = false;
+    bool m_painted = false;
 
     // Buttons
     QHash<Button, QPixmap> m_buttonPixmaps;
+    QString m_buttonPixmapsIconTheme;
+    bool m_buttonPixmapsDarkVariant = false;
     bool m_closeButtonHovered;
     bool m_maximizeButtonHovered;
     bool m_minimizeButtonHovered;
@@ -86,6 +94,7 @@ private:
     QPointF m_lastButtonClickPosition;
 
     QStaticText m_windowTitle;
+    const QFont *m_windowTitleFont = nullptr;
     Button m_clicking = None;
 
     GnomeHintsSettings *m_hints;
@@ -2,5 +2,11 @@ TEMPLATE = subdirs
 
 SUBDIRS += common decoration theme
 
+# Tests and benchmarks are built on request, qmake CONFIG+=build_tests
+build_tests {
+    SUBDIRS += tests
+    tests.depends = common
+}
+
 decoration.depends = common
 theme.depends = common
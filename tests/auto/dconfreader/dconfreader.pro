@@ -0,0 +1,18 @@
+TEMPLATE = app
+
+INCLUDEPATH += ../../../common
+
+CONFIG += testcase \
+          c++11 \
+          link_pkgconfig
+
+QT += testlib
+
+PKGCONFIG += glib-2.0
+
+TARGET = tst_dconfreader
+
+SOURCES += tst_dconfreader.cpp \
+           ../../../common/dconfreader.cpp
+
+HEADERS += ../../../common/dconfreader.h
@@ -0,0 +1,321 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "dconfreader.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+
+#include <algorithm>
+
+// Writes GVDB files laid out like "dconf update" does: paths are chains of
+// directory items, each holding its part of the name, and the locks are a nested
+// table of full paths
+class GvdbFixture
+{
+public:
+    void insert(const QByteArray &key, GVariant *value)
+    {
+        m_values.insert(key, value);
+    }
+
+    void lock(const QByteArray &key)
+    {
+        m_locks.insert(key, g_variant_new_string(""));
+    }
+
+    bool write(const QString &path) const
+    {
+        QByteArray data(24, '\0');
+
+        const QPair<quint32, quint32> locks = m_locks.isEmpty() ? qMakePair(0u, 0u) : writeTable(&data, m_locks, false, {});
+        const QPair<quint32, quint32> root = writeTable(&data, m_values, true, locks);
+
+        setUInt32(&data, 0, 0x72615647); // "GVar"
+        setUInt32(&data, 4, 0x746e6169); // "iant"
+        setUInt32(&data, 16, root.first);
+        setUInt32(&data, 20, root.second);
+
+        QFile file(path);
+        return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+    }
+
+private:
+    struct Item {
+        QByteArray key;
+        QByteArray name;
+        QByteArray parent;
+        char type;
+        GVariant *value;
+        QPair<quint32, quint32> table;
+    };
+
+    static void setUInt32(QByteArray *data, int offset, quint32 value)
+    {
+        qToLittleEndian<quint32>(value, reinterpret_cast<uchar *>(data->data()) + offset);
+    }
+
+    static void appendUInt32(QByteArray *data, quint32 value)
+    {
+        data->append(4, '\0');
+        setUInt32(data, data->size() - 4, value);
+    }
+
+    static void align(QByteArray *data, int alignment)
+    {
+        while (data->size() % alignment) {
+            data->append('\0');
+        }
+    }
+
+    static quint32 hash(const QByteArray &key)
+    {
+        quint32 hash = 5381;
+        for (const char c : key) {
+            hash = hash * 33 + static_cast<signed char>(c);
+        }
+        return hash;
+    }
+
+    static QPair<quint32, quint32> writeTable(QByteArray *data, const QMap<QByteArray, GVariant *> &values, bool directories,
+                                              const QPair<quint32, quint32> &locks)
+    {
+        // "/org/gnome/" is stored as "/" <- "org/" <- "gnome/"
+        QVector<Item> items;
+        QSet<QByteArray> keys;
+        for (auto it = values.constBegin(); it != values.constEnd(); ++it) {
+            if (!directories) {
+                items.append({ it.key(), it.key(), QByteArray(), 'v', it.value(), {} });
+                continue;
+            }
+
+            int start = 0;
+            QByteArray parent;
+            while (start < it.key().size()) {
+                const int slash = it.key().indexOf('/', start);
+                const int end = slash < 0 ? it.key().size() : slash + 1;
+                const QByteArray key = it.key().left(end);
+                if (!keys.contains(key)) {
+                    keys.insert(key);
+                    items.append({ key, key.mid(start), parent, slash < 0 ? 'v' : 'L', slash < 0 ? it.value() : nullptr, {} });
+                }
+                parent = key;
+                start = end;
+            }
+        }
+        if (locks.second) {
+            items.append({ QByteArrayLiteral(".locks"), QByteArrayLiteral(".locks"), QByteArray(), 'H', nullptr, locks });
+        }
+
+        // Items are grouped by bucket, a few of them so a lookup has to pick the right one
+        const quint32 bucketCount = 3;
+        std::stable_sort(items.begin(), items.end(), [] (const Item &a, const Item &b) {
+            return hash(a.key) % bucketCount < hash(b.key) % bucketCount;
+        });
+
+        QVector<QPair<quint32, quint32>> names;
+        QVector<QPair<quint32, quint32>> valueRanges;
+        for (const Item &item : qAsConst(items)) {
+            names.append(qMakePair(quint32(data->size()), quint32(item.name.size())));
+            data->append(item.name);
+
+            if (item.value) {
+                GVariant *variant = g_variant_ref_sink(g_variant_new_variant(item.value));
+                align(data, 8);
+                const quint32 start = data->size();
+                data->append(static_cast<const char *>(g_variant_get_data(variant)), int(g_variant_get_size(variant)));
+                valueRanges.append(qMakePair(start, quint32(data->size())));
+                g_variant_unref(variant);
+            } else {
+                valueRanges.append(item.table);
+            }
+        }
+
+        align(data, 4);
+        const quint32 tableStart = data->size();
+        appendUInt32(data, 0); // No bloom filter
+        appendUInt32(data, bucketCount);
+
+        int item = 0;
+        for (quint32 bucket = 0; bucket < bucketCount; ++bucket) {
+            while (item < items.size() && hash(items.at(item).key) % bucketCount < bucket) {
+                ++item;
+            }
+            appendUInt32(data, quint32(item));
+        }
+
+        for (int i = 0; i < items.size(); ++i) {
+            const Item &entry = items.at(i);
+            quint32 parent = 0xffffffffu;
+            for (int j = 0; j < items.size(); ++j) {
+                if (!entry.parent.isEmpty() && items.at(j).key == entry.parent) {
+                    parent = quint32(j);
+                }
+            }
+
+            appendUInt32(data, hash(entry.key));
+            appendUInt32(data, parent);
+            appendUInt32(data, names.at(i).first);
+            data->append(2, '\0');
+            qToLittleEndian<quint16>(quint16(names.at(i).second), reinterpret_cast<uchar *>(data->data()) + data->size() - 2);
+            data->append(entry.type);
+            data->append('\0');
+            appendUInt32(data, valueRanges.at(i).first);
+            appendUInt32(data, valueRanges.at(i).second);
+        }
+
+        return qMakePair(tableStart, quint32(data->size()));
+    }
+
+    QMap<QByteArray, GVariant *> m_values;
+    QMap<QByteArray, GVariant *> m_locks;
+};
+
+class tst_DConfReader : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void lookup_data();
+    void lookup();
+    void nestedDirectories();
+    void databaseOrder();
+    void locks();
+    void invalidDatabase();
+
+private:
+    QString database(const QString &name) const;
+
+    QTemporaryDir m_dir;
+};
+
+static const QByteArray gtkThemeKey = QByteArrayLiteral("/org/gnome/desktop/interface/gtk-theme");
+
+void tst_DConfReader::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+
+    GvdbFixture user;
+    user.insert(gtkThemeKey, g_variant_new_string("Adwaita-dark"));
+    user.insert("/org/gnome/desktop/interface/cursor-size", g_variant_new_int32(32));
+    user.insert("/org/gnome/desktop/interface/enable-animations", g_variant_new_boolean(FALSE));
+    user.insert("/org/gnome/desktop/interface/text-scaling-factor", g_variant_new_double(1.25));
+    user.insert("/org/gnome/desktop/wm/preferences/button-layout", g_variant_new_string("appmenu:minimize,close"));
+    // Same name as a key of the interface directory
+    user.insert("/org/gnome/desktop/wm/preferences/gtk-theme", g_variant_new_string("Wrong"));
+    // Locks of the user database are ignored
+    user.lock("/org/gnome/desktop/interface/cursor-size");
+    QVERIFY(user.write(database(QStringLiteral("user"))));
+
+    GvdbFixture local;
+    local.insert(gtkThemeKey, g_variant_new_string("Local"));
+    local.insert("/org/gnome/desktop/interface/cursor-size", g_variant_new_int32(48));
+    local.insert("/org/gnome/desktop/interface/icon-theme", g_variant_new_string("Papirus"));
+    local.lock(gtkThemeKey);
+    QVERIFY(local.write(database(QStringLiteral("local"))));
+
+    GvdbFixture site;
+    site.insert(gtkThemeKey, g_variant_new_string("Site"));
+    site.insert("/org/gnome/desktop/interface/icon-theme", g_variant_new_string("Adwaita"));
+    site.lock(gtkThemeKey);
+    site.lock("/org/gnome/desktop/interface/icon-theme");
+    QVERIFY(site.write(database(QStringLiteral("site"))));
+}
+
+QString tst_DConfReader::database(const QString &name) const
+{
+    return m_dir.filePath(name);
+}
+
+void tst_DConfReader::lookup_data()
+{
+    QTest::addColumn<QByteArray>("key");
+    QTest::addColumn<QVariant>("value");
+
+    QTest::newRow("string") << gtkThemeKey << QVariant(QStringLiteral("Adwaita-dark"));
+    QTest::newRow("int") << QByteArrayLiteral("/org/gnome/desktop/interface/cursor-size") << QVariant(32);
+    QTest::newRow("bool") << QByteArrayLiteral("/org/gnome/desktop/interface/enable-animations") << QVariant(false);
+    QTest::newRow("double") << QByteArrayLiteral("/org/gnome/desktop/interface/text-scaling-factor") << QVariant(qreal(1.25));
+    QTest::newRow("missing") << QByteArrayLiteral("/org/gnome/desktop/interface/icon-theme") << QVariant();
+    QTest::newRow("directory") << QByteArrayLiteral("/org/gnome/desktop/interface/") << QVariant();
+}
+
+void tst_DConfReader::lookup()
+{
+    QFETCH(QByteArray, key);
+    QFETCH(QVariant, value);
+
+    const DConfReader reader({ database(QStringLiteral("user")) });
+    QVERIFY(!reader.isEmpty());
+    QCOMPARE(reader.value(key), value);
+}
+
+void tst_DConfReader::nestedDirectories()
+{
+    const DConfReader reader({ database(QStringLiteral("user")) });
+
+    // The full chain of directories has to match, not only the last part
+    QCOMPARE(reader.value("/org/gnome/desktop/wm/preferences/button-layout"), QVariant(QStringLiteral("appmenu:minimize,close")));
+    QCOMPARE(reader.value("/org/gnome/desktop/wm/preferences/gtk-theme"), QVariant(QStringLiteral("Wrong")));
+    QCOMPARE(reader.value("/org/gnome/desktop/other/gtk-theme"), QVariant());
+    QCOMPARE(reader.value("/org/gnome/desktop/wm/button-layout"), QVariant());
+    QCOMPARE(reader.value("gtk-theme"), QVariant());
+}
+
+void tst_DConfReader::databaseOrder()
+{
+    // The first database having the key wins
+    const DConfReader reader({ database(QStringLiteral("user")), database(QStringLiteral("local")) });
+    QCOMPARE(reader.value("/org/gnome/desktop/interface/enable-animations"), QVariant(false));
+    QCOMPARE(reader.value("/org/gnome/desktop/interface/icon-theme"), QVariant(QStringLiteral("Papirus")));
+}
+
+void tst_DConfReader::locks()
+{
+    const DConfReader reader({ database(QStringLiteral("user")), database(QStringLiteral("local")), database(QStringLiteral("site")) });
+
+    // Locked by both system databases, the last one decides
+    QCOMPARE(reader.value(gtkThemeKey), QVariant(QStringLiteral("Site")));
+    QCOMPARE(reader.value("/org/gnome/desktop/interface/icon-theme"), QVariant(QStringLiteral("Adwaita")));
+    // Only locked in the user database
+    QCOMPARE(reader.value("/org/gnome/desktop/interface/cursor-size"), QVariant(32));
+
+    const DConfReader localReader({ database(QStringLiteral("user")), database(QStringLiteral("local")) });
+    QCOMPARE(localReader.value(gtkThemeKey), QVariant(QStringLiteral("Local")));
+    QCOMPARE(localReader.value("/org/gnome/desktop/interface/cursor-size"), QVariant(32));
+}
+
+void tst_DConfReader::invalidDatabase()
+{
+    QFile file(database(QStringLiteral("invalid")));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("GVariant but not really");
+    file.close();
+
+    const DConfReader reader({ database(QStringLiteral("invalid")), database(QStringLiteral("missing")) });
+    QVERIFY(reader.isEmpty());
+    QCOMPARE(reader.value(gtkThemeKey), QVariant());
+}
+
+QTEST_GUILESS_MAIN(tst_DConfReader)
+
+#include "tst_dconfreader.moc"
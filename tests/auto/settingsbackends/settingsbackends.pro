@@ -0,0 +1,24 @@
+TEMPLATE = app
+
+QMAKE_LIBDIR += ../../../common
+INCLUDEPATH += ../../../common
+
+CONFIG += testcase \
+          c++11 \
+          link_pkgconfig
+
+QT += dbus \
+      gui-private \
+      testlib \
+      theme_support-private \
+      widgets \
+      x11extras
+
+LIBS += -lcommon
+
+PKGCONFIG += gtk+-3.0 \
+             gtk+-x11-3.0
+
+TARGET = tst_settingsbackends
+
+SOURCES += tst_settingsbackends.cpp
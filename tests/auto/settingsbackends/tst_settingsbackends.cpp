@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "gsettingsbackend.h"
+#include "xfconfsettingsbackend.h"
+
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QtTest>
+
+#include <memory>
+
+typedef GnomeHintsSettings::SettingKey SettingKey;
+
+struct KeyLocation {
+    SettingKey key;
+    const char *schemaId;
+    const char *name;
+};
+typedef QVector<KeyLocation> KeyLocations;
+Q_DECLARE_METATYPE(KeyLocations)
+
+typedef GSettingsBackend *(*BackendFactory)(QObject *);
+Q_DECLARE_METATYPE(BackendFactory)
+
+class tst_SettingsBackends : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void gsettingsKeys_data();
+    void gsettingsKeys();
+    void xfwmButtonLayout_data();
+    void xfwmButtonLayout();
+    void xfconfValues();
+    void xfconfProperties();
+
+private:
+    QTemporaryDir m_schemaDir;
+};
+
+void tst_SettingsBackends::initTestCase()
+{
+    // The keys are looked up in the test schemas, written to memory only
+    QVERIFY(m_schemaDir.isValid());
+    QProcess compiler;
+    compiler.start(QStringLiteral("glib-compile-schemas"),
+                   { QStringLiteral("--targetdir=") + m_schemaDir.path(), QFINDTESTDATA("schemas") });
+    if (!compiler.waitForFinished() || compiler.exitStatus() != QProcess::NormalExit) {
+        QSKIP("glib-compile-schemas is not available");
+    }
+    QCOMPARE(compiler.exitCode(), 0);
+
+    qputenv("GSETTINGS_SCHEMA_DIR", QFile::encodeName(m_schemaDir.path()));
+    qputenv("GSETTINGS_BACKEND", "memory");
+    qunsetenv("QGNOMEPLATFORM_DCONF_DIRECT");
+}
+
+void tst_SettingsBackends::gsettingsKeys_data()
+{
+    QTest::addColumn<BackendFactory>("factory");
+    QTest::addColumn<KeyLocations>("locations");
+
+    QTest::newRow("gnome") << BackendFactory(&GSettingsBackend::gnome) << KeyLocations {
+        { GnomeHintsSettings::GtkThemeKey, "org.gnome.desktop.interface", "gtk-theme" },
+        { GnomeHintsSettings::IconThemeKey, "org.gnome.desktop.interface", "icon-theme" },
+        { GnomeHintsSettings::CursorBlinkKey, "org.gnome.desktop.interface", "cursor-blink" },
+        { GnomeHintsSettings::CursorBlinkTimeKey, "org.gnome.desktop.interface", "cursor-blink-time" },
+        { GnomeHintsSettings::CursorBlinkTimeoutKey, "org.gnome.desktop.interface", "cursor-blink-timeout" },
+        { GnomeHintsSettings::CursorSizeKey, "org.gnome.desktop.interface", "cursor-size" },
+        { GnomeHintsSettings::FontNameKey, "org.gnome.desktop.interface", "font-name" },
+        { GnomeHintsSettings::MonospaceFontNameKey, "org.gnome.desktop.interface", "monospace-font-name" },
+        { GnomeHintsSettings::TextScalingFactorKey, "org.gnome.desktop.interface", "text-scaling-factor" },
+        // Not in the interface schema of the test, like before GNOME 40
+        { GnomeHintsSettings::FontAntialiasingKey, "org.gnome.settings-daemon.plugins.xsettings", "antialiasing" },
+        { GnomeHintsSettings::FontHintingKey, "org.gnome.desktop.interface", "font-hinting" },
+        { GnomeHintsSettings::FontRgbaOrderKey, "org.gnome.desktop.interface", "font-rgba-order" },
+        { GnomeHintsSettings::EnableAnimationsKey, "org.gnome.desktop.interface", "enable-animations" },
+        { GnomeHintsSettings::TitlebarFontKey, "org.gnome.desktop.wm.preferences", "titlebar-font" },
+        { GnomeHintsSettings::ButtonLayoutKey, "org.gnome.desktop.wm.preferences", "button-layout" },
+        { GnomeHintsSettings::DoubleClickTimeKey, "org.gnome.desktop.peripherals.mouse", "double-click" },
+        { GnomeHintsSettings::DragThresholdKey, "org.gnome.desktop.peripherals.mouse", "drag-threshold" }
+    };
+
+    QTest::newRow("cinnamon") << BackendFactory(&GSettingsBackend::cinnamon) << KeyLocations {
+        { GnomeHintsSettings::GtkThemeKey, "org.cinnamon.desktop.interface", "gtk-theme" },
+        { GnomeHintsSettings::IconThemeKey, "org.cinnamon.desktop.interface", "icon-theme" },
+        // Not in the Cinnamon interface schema of the test, shared with GNOME
+        { GnomeHintsSettings::CursorBlinkKey, "org.gnome.desktop.interface", "cursor-blink" },
+        { GnomeHintsSettings::CursorBlinkTimeKey, "org.cinnamon.desktop.interface", "cursor-blink-time" },
+        { GnomeHintsSettings::CursorBlinkTimeoutKey, "org.gnome.desktop.interface", "cursor-blink-timeout" },
+        { GnomeHintsSettings::CursorSizeKey, "org.cinnamon.desktop.interface", "cursor-size" },
+        { GnomeHintsSettings::FontNameKey, "org.cinnamon.desktop.interface", "font-name" },
+        { GnomeHintsSettings::MonospaceFontNameKey, "org.gnome.desktop.interface", "monospace-font-name" },
+        { GnomeHintsSettings::TextScalingFactorKey, "org.cinnamon.desktop.interface", "text-scaling-factor" },
+        { GnomeHintsSettings::FontAntialiasingKey, "org.cinnamon.settings-daemon.plugins.xsettings", "antialiasing" },
+        { GnomeHintsSettings::FontHintingKey, "org.cinnamon.settings-daemon.plugins.xsettings", "hinting" },
+        { GnomeHintsSettings::FontRgbaOrderKey, "org.cinnamon.settings-daemon.plugins.xsettings", "rgba-order" },
+        { GnomeHintsSettings::EnableAnimationsKey, "org.cinnamon.desktop.interface", "enable-animations" },
+        { GnomeHintsSettings::TitlebarFontKey, "org.gnome.desktop.wm.preferences", "titlebar-font" },
+        { GnomeHintsSettings::ButtonLayoutKey, "org.gnome.desktop.wm.preferences", "button-layout" },
+        { GnomeHintsSettings::DoubleClickTimeKey, "org.gnome.desktop.peripherals.mouse", "double-click" },
+        { GnomeHintsSettings::DragThresholdKey, "org.gnome.desktop.peripherals.mouse", "drag-threshold" }
+    };
+
+    QTest::newRow("mate") << BackendFactory(&GSettingsBackend::mate) << KeyLocations {
+        { GnomeHintsSettings::GtkThemeKey, "org.mate.interface", "gtk-theme" },
+        { GnomeHintsSettings::IconThemeKey, "org.mate.interface", "icon-theme" },
+        { GnomeHintsSettings::CursorBlinkKey, "org.mate.interface", "cursor-blink" },
+        { GnomeHintsSettings::CursorBlinkTimeKey, "org.mate.interface", "cursor-blink-time" },
+        { GnomeHintsSettings::CursorBlinkTimeoutKey, "org.mate.interface", "cursor-blink-timeout" },
+        { GnomeHintsSettings::CursorSizeKey, "org.mate.peripherals-mouse", "cursor-size" },
+        { GnomeHintsSettings::FontNameKey, "org.mate.interface", "font-name" },
+        { GnomeHintsSettings::MonospaceFontNameKey, "org.mate.interface", "monospace-font-name" },
+        { GnomeHintsSettings::FontAntialiasingKey, "org.mate.font-rendering", "antialiasing" },
+        { GnomeHintsSettings::FontHintingKey, "org.mate.font-rendering", "hinting" },
+        { GnomeHintsSettings::FontRgbaOrderKey, "org.mate.font-rendering", "rgba-order" },
+        { GnomeHintsSettings::EnableAnimationsKey, "org.mate.interface", "enable-animations" },
+        { GnomeHintsSettings::TitlebarFontKey, "org.mate.Marco.general", "titlebar-font" },
+        { GnomeHintsSettings::ButtonLayoutKey, "org.mate.Marco.general", "button-layout" },
+        { GnomeHintsSettings::DoubleClickTimeKey, "org.mate.peripherals-mouse", "double-click" },
+        { GnomeHintsSettings::DragThresholdKey, "org.mate.peripherals-mouse", "drag-threshold" }
+    };
+}
+
+void tst_SettingsBackends::gsettingsKeys()
+{
+    QFETCH(BackendFactory, factory);
+    QFETCH(KeyLocations, locations);
+
+    // A value telling the keys apart is written to each location
+    QVariant expected[GnomeHintsSettings::SettingKeyCount];
+    for (const KeyLocation &location : locations) {
+        GSettings *settings = g_settings_new(location.schemaId);
+        GSettingsSchema *schema = nullptr;
+        g_object_get(settings, "settings-schema", &schema, nullptr);
+        GSettingsSchemaKey *schemaKey = g_settings_schema_get_key(schema, location.name);
+        const GVariantType *type = g_settings_schema_key_get_value_type(schemaKey);
+
+        GVariant *value = nullptr;
+        if (g_variant_type_equal(type, G_VARIANT_TYPE_STRING)) {
+            const QByteArray string = QByteArray(location.schemaId) + '/' + location.name;
+            value = g_variant_new_string(string.constData());
+            expected[location.key] = QString::fromUtf8(string);
+        } else if (g_variant_type_equal(type, G_VARIANT_TYPE_INT32)) {
+            value = g_variant_new_int32(100 + location.key);
+            expected[location.key] = 100 + location.key;
+        } else if (g_variant_type_equal(type, G_VARIANT_TYPE_DOUBLE)) {
+            value = g_variant_new_double(1.5);
+            expected[location.key] = qreal(1.5);
+        } else if (g_variant_type_equal(type, G_VARIANT_TYPE_BOOLEAN)) {
+            // The defaults are false
+            value = g_variant_new_boolean(TRUE);
+            expected[location.key] = true;
+        }
+
+        QVERIFY2(value, location.name);
+        QVERIFY(g_settings_set_value(settings, location.name, value));
+
+        g_settings_schema_key_unref(schemaKey);
+        g_settings_schema_unref(schema);
+        g_object_unref(settings);
+    }
+
+    const std::unique_ptr<GSettingsBackend> backend(factory(nullptr));
+    QVariant values[GnomeHintsSettings::SettingKeyCount];
+    backend->readAll(values);
+
+    for (int key = 0; key < GnomeHintsSettings::SettingKeyCount; ++key) {
+        QCOMPARE(values[key], expected[key]);
+    }
+}
+
+void tst_SettingsBackends::xfwmButtonLayout_data()
+{
+    QTest::addColumn<QString>("xfwmLayout");
+    QTest::addColumn<QString>("gnomeLayout");
+
+    QTest::newRow("default") << QStringLiteral("O|HMC") << QStringLiteral("menu:minimize,maximize,close");
+    QTest::newRow("left") << QStringLiteral("CMH|") << QStringLiteral("close,maximize,minimize:");
+    QTest::newRow("both sides") << QStringLiteral("C|O") << QStringLiteral("close:menu");
+    QTest::newRow("no title") << QStringLiteral("HMC") << QStringLiteral("minimize,maximize,close:");
+    QTest::newRow("shade and stick") << QStringLiteral("OS|THC") << QStringLiteral("menu:minimize,close");
+    QTest::newRow("empty") << QString() << QStringLiteral(":");
+}
+
+void tst_SettingsBackends::xfwmButtonLayout()
+{
+    QFETCH(QString, xfwmLayout);
+    QFETCH(QString, gnomeLayout);
+
+    QCOMPARE(XfconfSettingsBackend::toSettingValue(GnomeHintsSettings::ButtonLayoutKey, xfwmLayout), QVariant(gnomeLayout));
+}
+
+void tst_SettingsBackends::xfconfValues()
+{
+    QCOMPARE(XfconfSettingsBackend::toSettingValue(GnomeHintsSettings::FontAntialiasingKey, 0), QVariant(QStringLiteral("none")));
+    QCOMPARE(XfconfSettingsBackend::toSettingValue(GnomeHintsSettings::FontAntialiasingKey, 1), QVariant(QStringLiteral("rgba")));
+    QCOMPARE(XfconfSettingsBackend::toSettingValue(GnomeHintsSettings::FontAntialiasingKey, -1), QVariant());
+    QCOMPARE(XfconfSettingsBackend::toSettingValue(GnomeHintsSettings::FontHintingKey, QStringLiteral("hintslight")), QVariant(QStringLiteral("slight")));
+    QCOMPARE(XfconfSettingsBackend::toSettingValue(GnomeHintsSettings::EnableAnimationsKey, 0), QVariant(false));
+    QCOMPARE(XfconfSettingsBackend::toSettingValue(GnomeHintsSettings::CursorSizeKey, QStringLiteral("32")), QVariant(32));
+    QCOMPARE(XfconfSettingsBackend::toSettingValue(GnomeHintsSettings::GtkThemeKey, QStringLiteral("Greybird")), QVariant(QStringLiteral("Greybird")));
+}
+
+void tst_SettingsBackends::xfconfProperties()
+{
+    QCOMPARE(XfconfSettingsBackend::keyForProperty(QStringLiteral("xsettings"), QStringLiteral("/Net/ThemeName")), GnomeHintsSettings::GtkThemeKey);
+    QCOMPARE(XfconfSettingsBackend::keyForProperty(QStringLiteral("xfwm4"), QStringLiteral("/general/button_layout")), GnomeHintsSettings::ButtonLayoutKey);
+    // Right property, wrong channel
+    QCOMPARE(XfconfSettingsBackend::keyForProperty(QStringLiteral("xfwm4"), QStringLiteral("/Net/ThemeName")), GnomeHintsSettings::SettingKeyCount);
+    QCOMPARE(XfconfSettingsBackend::keyForProperty(QStringLiteral("xsettings"), QStringLiteral("/Net/SoundThemeName")), GnomeHintsSettings::SettingKeyCount);
+}
+
+QTEST_GUILESS_MAIN(tst_SettingsBackends)
+
+#include "tst_settingsbackends.moc"
@@ -0,0 +1,20 @@
+TEMPLATE = app
+
+INCLUDEPATH += ../../../common
+
+CONFIG += benchmark \
+          c++11
+
+QT += dbus \
+      gui-private \
+      testlib \
+      widgets
+
+TARGET = tst_bench_themehint
+
+SOURCES += tst_bench_themehint.cpp \
+           ../../../common/runtimestats.cpp
+
+HEADERS += ../../../common/atomicsnapshot.h \
+           ../../../common/runtimestats.h \
+           ../../../common/themehinttable.h
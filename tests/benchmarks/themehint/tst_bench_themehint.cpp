@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2016-2019 Jan Grulich
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ */
+
+#include "themehinttable.h"
+
+#include <QDialogButtonBox>
+#include <QHash>
+#include <QtTest>
+
+#include <qpa/qplatformtheme.h>
+
+// The hints Qt asks for while starting up and while handling input
+static const QPlatformTheme::ThemeHint commonHints[] = {
+    QPlatformTheme::CursorFlashTime,
+    QPlatformTheme::KeyboardInputInterval,
+    QPlatformTheme::MouseDoubleClickInterval,
+    QPlatformTheme::StartDragDistance,
+    QPlatformTheme::StartDragTime,
+    QPlatformTheme::PasswordMaskDelay,
+    QPlatformTheme::StyleNames,
+    QPlatformTheme::SystemIconThemeName,
+    QPlatformTheme::IconThemeSearchPaths,
+    QPlatformTheme::DialogButtonBoxLayout,
+    QPlatformTheme::DialogButtonBoxButtonsHaveIcons,
+    QPlatformTheme::KeyboardScheme,
+    QPlatformTheme::UiEffects,
+    QPlatformTheme::ToolButtonStyle,
+    QPlatformTheme::ToolBarIconSize,
+    QPlatformTheme::ItemViewActivateItemOnSingleClick,
+    QPlatformTheme::IconPixmapSizes,
+    QPlatformTheme::PasswordMaskCharacter,
+    QPlatformTheme::MouseDoubleClickDistance,
+    QPlatformTheme::WheelScrollLines,
+    QPlatformTheme::TabFocusBehavior
+};
+
+// What GnomeHintsSettings provides, the rest comes from QPlatformTheme
+static QHash<QPlatformTheme::ThemeHint, QVariant> settingsHints()
+{
+    QHash<QPlatformTheme::ThemeHint, QVariant> hints;
+    hints[QPlatformTheme::CursorFlashTime] = 1200;
+    hints[QPlatformTheme::MouseDoubleClickInterval] = 400;
+    hints[QPlatformTheme::StartDragDistance] = 8;
+    hints[QPlatformTheme::StyleNames] = QStringList() << QStringLiteral("adwaita") << QStringLiteral("fusion");
+    hints[QPlatformTheme::SystemIconThemeName] = QStringLiteral("Adwaita");
+    hints[QPlatformTheme::IconThemeSearchPaths] = QStringList() << QStringLiteral("/usr/share/icons");
+    hints[QPlatformTheme::DialogButtonBoxLayout] = QDialogButtonBox::GnomeLayout;
+    hints[QPlatformTheme::DialogButtonBoxButtonsHaveIcons] = true;
+    hints[QPlatformTheme::KeyboardScheme] = QPlatformTheme::GnomeKeyboardScheme;
+    hints[QPlatformTheme::UiEffects] = QPlatformTheme::GeneralUiEffect;
+    hints[QPlatformTheme::IconPixmapSizes] = QVariant::fromValue(QList<int>() << 512 << 256 << 128 << 64 << 32 << 22 << 16 << 8);
+    hints[QPlatformTheme::PasswordMaskCharacter] = QVariant(QChar(0x2022));
+    return hints;
+}
+
+class tst_ThemeHint : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void hashLookup();
+    void tableLookup();
+};
+
+// The lookup before the hints were kept in tables
+void tst_ThemeHint::hashLookup()
+{
+    const QHash<QPlatformTheme::ThemeHint, QVariant> hints = settingsHints();
+
+    int valid = 0;
+    QBENCHMARK {
+        for (QPlatformTheme::ThemeHint hintType : commonHints) {
+            QVariant hint = hints.value(hintType);
+            if (!hint.isValid()) {
+                hint = QPlatformTheme::defaultThemeHint(hintType);
+            }
+            valid += hint.isValid();
+        }
+    }
+
+    QVERIFY(valid > 0);
+}
+
+// QGnomePlatformTheme::themeHint(), counting the call included, with the hints
+// the settings don't have answered by QPlatformTheme
+void tst_ThemeHint::tableLookup()
+{
+    const QHash<QPlatformTheme::ThemeHint, QVariant> hints = settingsHints();
+    QVariant values[GnomeHintsSettings::ThemeHintCount];
+    for (auto it = hints.constBegin(); it != hints.constEnd(); ++it) {
+        values[it.key()] = it.value();
+    }
+
+    ThemeHintTable table;
+    table.update(values);
+    const QPlatformTheme theme;
+
+    int valid = 0;
+    QBENCHMARK {
+        for (QPlatformTheme::ThemeHint hintType : commonHints) {
+            valid += table.themeHint(hintType, &theme).isValid();
+        }
+    }
+
+    QVERIFY(valid > 0);
+}
+
+// Some fallbacks come from the platform integration, which needs the application
+QTEST_MAIN(tst_ThemeHint)
+
+#include "tst_bench_themehint.moc"
@@ -20,12 +20,18 @@
 
 #include "qgnomeplatformtheme.h"
 #include "gnomehintssettings.h"
+#include "phasetrace.h"
+#include "runtimestats.h"
 #include "qgtk3dialoghelpers.h"
 
 #include <QApplication>
 #include <QStyleFactory>
 #include <QX11Info>
 
+#undef signals
+#include <pango/pango.h>
+#define signals Q_SIGNALS
+
 #if !defined(QT_NO_DBUS) && !defined(QT_NO_SYSTEMTRAYICON)
 #include <private/qdbustrayicon_p.h>
 #endif
@@ -48,27 +54,27 @@ QGnomePlatformTheme::QGnomePlatformTheme()
 
 QGnomePlatformTheme::~QGnomePlatformTheme()
 {
-    delete m_hints;
+    QObject::disconnect(m_settingsConnection);
+    GnomeHintsSettings::release(m_hints);
 }
 
 QVariant QGnomePlatformTheme::themeHint(QPlatformTheme::ThemeHint hintType) const
 {
-    QVariant hint = m_hints->hint(hintType);
-    if (hint.isValid()) {
-        return hint;
-    } else {
-        return QPlatformTheme::themeHint(hintType);
-    }
+    return m_themeHints.themeHint(hintType, this);
 }
 
 const QFont *QGnomePlatformTheme::font(Font type) const
 {
+    RuntimeStats::count(RuntimeStats::FontCalls);
+
     return m_hints->font(type);
 }
 
 const QPalette *QGnomePlatformTheme::palette(Palette type) const
 {
-    QPalette *palette = m_hints->palette();
+    RuntimeStats::count(RuntimeStats::PaletteCalls);
+
+    const QPalette *palette = m_hints->palette();
     if (palette && type == QPlatformTheme::SystemPalette) {
         return palette;
     } else {
@@ -94,12 +100,18 @@ bool QGnomePlatformTheme::usePlatformNativeDialog(QPlatformTheme::DialogType typ
 QPlatformDialogHelper *QGnomePlatformTheme::createPlatformDialogHelper(QPlatformTheme::DialogType type) const
 {
     switch (type) {
-    case QPlatformTheme::FileDialog:
+    case QPlatformTheme::FileDialog: {
+        PhaseTraceScope trace("QGtk3FileDialogHelper");
         return new QGtk3FileDialogHelper();
-    case QPlatformTheme::FontDialog:
+    }
+    case QPlatformTheme::FontDialog: {
+        PhaseTraceScope trace("QGtk3FontDialogHelper");
         return new QGtk3FontDialogHelper();
-    case QPlatformTheme::ColorDialog:
+    }
+    case QPlatformTheme::ColorDialog: {
+        PhaseTraceScope trace("QGtk3ColorDialogHelper");
         return new QGtk3ColorDialogHelper();
+    }
     case QPlatformTheme::MessageDialog:
     default:
         return 0;
@@ -131,5 +143,16 @@ QPlatformSystemTrayIcon * QGnomePlatformTheme::createPlatformSystemTrayIcon() co
 
 void QGnomePlatformTheme::loadSettings()
 {
-    m_hints = new GnomeHintsSettings;
+    m_hints = GnomeHintsSettings::acquire();
+
+    loadThemeHints();
+
+    m_settingsConnection = QObject::connect(m_hints, &GnomeHintsSettings::settingsChanged, [this] () {
+        loadThemeHints();
+    });
+}
+
+void QGnomePlatformTheme::loadThemeHints()
+{
+    m_themeHints.update(m_hints->snapshot()->hints);
 }
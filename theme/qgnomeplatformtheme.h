@@ -25,7 +25,8 @@
 #include <QPalette>
 #include <qpa/qplatformtheme.h>
 
-class GnomeHintsSettings;
+#include "gnomehintssettings.h"
+#include "themehinttable.h"
 
 class QGnomePlatformTheme : public QPlatformTheme
 {
@@ -44,8 +45,11 @@ public:
 
 private:
     void loadSettings();
+    void loadThemeHints();
 
     GnomeHintsSettings *m_hints;
+    QMetaObject::Connection m_settingsConnection;
+    ThemeHintTable m_themeHints;
 };
 
 #endif // QGNOME_PLATFORM_THEME_HH